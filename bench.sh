@@ -0,0 +1,10 @@
+#!/bin/sh
+# builds and runs the benchmarks in bench/ (optimised, one program each)
+set -e
+mkdir -p build
+for bench in bench/*.cc; do
+    name=$(basename "$bench" .cc)
+    ${CXX:-clang++} -std=c++20 "$bench" json.cc compact.cc bind.cc template.cc path.cc columns.cc index.cc -I. -o "build/bench_$name" -Wall -Wextra -O3 -pthread
+    echo "== $name"
+    "./build/bench_$name"
+done
@@ -0,0 +1,101 @@
+// allocations per message for a stream of small messages: parseCompact
+// (whose small arrays and objects are inline), json::parse, and a
+// DocumentParser reusing its tree.
+
+#include "../compact.h"
+#include "../json.h"
+#include "counting.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::string> messages(size_t count)
+{
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string n = std::to_string(i);
+        switch (i % 5) {
+            case 0:
+                corpus.push_back(R"({"id":)" + n +
+                                 R"(,"ok":true,"tags":["a","b"],"meta":{}})");
+                break;
+            case 1:
+                corpus.push_back(R"({"type":"click","pos":[10,20],"mods":[]})");
+                break;
+            case 2:
+                corpus.push_back(R"({"user":{"id":7,"name":"bob"},)"
+                                 R"("items":[{"sku":"x1","qty":2}],)"
+                                 R"("errors":[]})");
+                break;
+            case 3: corpus.push_back(R"({"ack":)" + n + "}"); break;
+            case 4: corpus.push_back(R"([1,2,3,{"k":null}])"); break;
+        }
+    }
+    return corpus;
+}
+
+// parses every message and keeps the results, so what's still held at the
+// end is what the values themselves need
+template <typename Value, typename Parse>
+void measure(const char* name, const std::vector<std::string>& corpus,
+             Parse parse)
+{
+    std::vector<Value> kept;
+    kept.reserve(corpus.size());
+    counting::Counts counts;
+    {
+        counting::Scope scope;
+        for (const std::string& message : corpus) {
+            kept.push_back(parse(message));
+        }
+        counts = counting::counts;
+    }
+    const auto messageCount = static_cast<double>(corpus.size());
+    std::printf("%-16s %5.1f allocations per message, %5.1f bytes held\n",
+                name, static_cast<double>(counts.allocations) / messageCount,
+                static_cast<double>(counts.allocated - counts.freed) /
+                  messageCount);
+}
+
+void documentParser(const char* name, const std::vector<std::string>& corpus)
+{
+    json::DocumentParser parser;
+    counting::Counts counts;
+    {
+        counting::Scope scope;
+        for (const std::string& message : corpus) {
+            parser.parse(message);
+        }
+        counts = counting::counts;
+    }
+    std::printf("%-16s %5.1f allocations per message\n", name,
+                static_cast<double>(counts.allocations) /
+                  static_cast<double>(corpus.size()));
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<std::string> corpus = messages(10000);
+    measure<json::CompactValue>(
+      "parseCompact", corpus,
+      [](const std::string& m) { return json::parseCompact(m); });
+    measure<json::JsonValue>("json::parse", corpus, [](const std::string& m) {
+        return json::parse(m);
+    });
+
+    // nothing is kept here, the tree is parsed over every time. with
+    // messages of one shape it's reused entirely.
+    documentParser("DocumentParser", corpus);
+    std::vector<std::string> sameShape;
+    for (size_t i = 0; i < corpus.size(); i += 5) {
+        sameShape.push_back(corpus[i]);
+    }
+    documentParser("  same shape", sameShape);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// replaces the global operator new and delete with ones that count what
+// goes through them. include it in exactly one file of a benchmark.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace counting
+{
+
+struct Counts
+{
+    size_t allocations = 0;
+    // bytes asked for, and given back while counting
+    size_t allocated = 0;
+    size_t freed = 0;
+};
+
+inline Counts counts;
+inline bool enabled = false;
+
+// counts is reset and counting enabled until the Scope goes
+struct Scope
+{
+    Scope()
+    {
+        counts = {};
+        enabled = true;
+    }
+    ~Scope() { enabled = false; }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+// every block starts with its size, so delete knows how much it frees
+constexpr size_t header = alignof(std::max_align_t);
+
+} // namespace counting
+
+void* operator new(size_t size)
+{
+    auto* block = static_cast<char*>(std::malloc(size + counting::header));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    if (counting::enabled) {
+        counting::counts.allocations++;
+        counting::counts.allocated += size;
+    }
+    return block + counting::header;
+}
+void operator delete(void* pointer) noexcept
+{
+    if (pointer == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - counting::header;
+    if (counting::enabled) {
+        counting::counts.freed += *reinterpret_cast<size_t*>(block);
+    }
+    std::free(block);
+}
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+void operator delete[](void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+void operator delete(void* pointer, size_t /*size*/) noexcept
+{
+    operator delete(pointer);
+}
+void operator delete[](void* pointer, size_t /*size*/) noexcept
+{
+    operator delete(pointer);
+}
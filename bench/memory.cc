@@ -0,0 +1,61 @@
+// how big values are, and how much heap a parsed document takes per MB of
+// input: JsonValue against CompactValue on an array of small records.
+
+#include "../compact.h"
+#include "../json.h"
+#include "counting.h"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+
+std::string records(size_t count)
+{
+    std::string source = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += R"({"id":)" + std::to_string(i) + R"(,"name":"user)" +
+                  std::to_string(i) + R"(","active":true,"score":)" +
+                  std::to_string(i * 0.5) +
+                  R"(,"tags":["a","bb","a much longer tag value"],)"
+                  R"("geo":{"lat":1.5,"lon":-2.25}})";
+    }
+    return source + "]";
+}
+
+// heap still held once parse's result is built, per MB of source
+template <typename Parse>
+void measure(const char* name, const std::string& source, Parse parse)
+{
+    counting::Counts held;
+    {
+        counting::Scope scope;
+        auto value = parse(source);
+        held = counting::counts;
+    }
+    const double megabytes = static_cast<double>(source.size()) / (1 << 20);
+    std::printf("%-12s %6.1f MB per MB of input, %zu allocations\n", name,
+                static_cast<double>(held.allocated - held.freed) / (1 << 20) /
+                  megabytes,
+                held.allocations);
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("sizeof(JsonValue) %zu, sizeof(CompactValue) %zu\n",
+                sizeof(json::JsonValue), sizeof(json::CompactValue));
+
+    const std::string source = records(20000);
+    std::printf("%zu records, %.1f MB\n", size_t{20000},
+                static_cast<double>(source.size()) / (1 << 20));
+    measure("JsonValue", source,
+            [](const std::string& s) { return json::parse(s); });
+    measure("CompactValue", source,
+            [](const std::string& s) { return json::parseCompact(s); });
+}
@@ -0,0 +1,68 @@
+// ParseOptions::precount: allocations, and bytes freed during the parse
+// (mostly buffers that containers outgrew), with and without it.
+
+#include "../json.h"
+#include "counting.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+
+std::string records(size_t count)
+{
+    std::string source = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += R"({"id":)" + std::to_string(i) + R"(,"name":"user [)" +
+                  std::to_string(i) +
+                  R"(]","tags":["a","b","c",{"x":1}],)"
+                  R"("scores":[1,2,3,4,5,6,7,8,9,10,11,12,13],)"
+                  R"("nested":{"a":[[1],[2,3]],"b":null}})";
+    }
+    return source + "]";
+}
+std::string smallArrays(size_t count)
+{
+    std::string source = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += i % 2 != 0 ? R"("s")" : "[1,2]";
+    }
+    return source + "]";
+}
+
+void measure(const char* name, const std::string& source)
+{
+    for (bool precount : {false, true}) {
+        json::ParseOptions options{.precount = precount};
+        counting::Counts counts;
+        double milliseconds = 0;
+        {
+            counting::Scope scope;
+            auto start = std::chrono::steady_clock::now();
+            json::JsonValue value = json::parse(source, options);
+            milliseconds = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+            counts = counting::counts;
+        }
+        std::printf("%-14s %-9s %8zu allocations, %6.1f MB freed, %5.1f ms\n",
+                    name, precount ? "precount" : "default", counts.allocations,
+                    static_cast<double>(counts.freed) / 1e6, milliseconds);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    measure("20k records", records(20000));
+    measure("200k small", smallArrays(200000));
+}
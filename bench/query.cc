@@ -0,0 +1,115 @@
+// json::Query: filters over a million parsed records (and a packed array of
+// a million numbers), against the obvious loops with find.
+
+#include "../json.h"
+#include "../path.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// a million items with a price and a stock count, and as many readings
+std::string document()
+{
+    std::string source = R"({"items": [)";
+    for (size_t i = 0; i < 1000000; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += R"({"id": )" + std::to_string(i) + R"(, "name": "item )" +
+                  std::to_string(i) + R"(", "price": )" +
+                  std::to_string((i * 7919) % 200) + R"(, "stock": )" +
+                  std::to_string((i * 104729) % 50) +
+                  R"(, "tags": ["a", "b"]})";
+    }
+    source += R"(], "readings": [)";
+    for (size_t i = 0; i < 1000000; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += std::to_string((i * 7919) % 200) + ".5";
+    }
+    return source + "]}";
+}
+
+// the best of five runs of work, in milliseconds
+template <typename Work>
+double best(const Work& work, size_t& found)
+{
+    double result = 1e9;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        found = work();
+        result = std::min(result, std::chrono::duration<double, std::milli>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+    }
+    return result;
+}
+
+void report(const char* what, const json::JsonValue& root,
+            const char* path, const auto& loop)
+{
+    json::Query query(path);
+    size_t fromQuery = 0;
+    size_t fromLoop = 0;
+    double queried = best([&] { return query.run(root).size(); }, fromQuery);
+    double looped = best(loop, fromLoop);
+    std::printf("%-16s query %6.1f ms, loop %6.1f ms (%zu/%zu matches)\n",
+                what, queried, looped, fromQuery, fromLoop);
+}
+
+} // namespace
+
+int main()
+{
+    const json::JsonValue root = json::parse(document());
+    const json::JsonArray& items = root.find("items")->asArray();
+
+    report("one condition", root, "$.items[?(@.price > 100)]", [&] {
+        std::vector<const json::JsonValue*> matches;
+        for (const json::JsonValue& item : items) {
+            const json::JsonValue* price = item.find("price");
+            if (price != nullptr && price->isNumber() &&
+                price->asNumber() > 100)
+            {
+                matches.push_back(&item);
+            }
+        }
+        return matches.size();
+    });
+
+    report("three conditions", root,
+           "$.items[?(@.price > 100 && @.stock < 10 && @.name != 'x')]", [&] {
+               std::vector<const json::JsonValue*> matches;
+               for (const json::JsonValue& item : items) {
+                   const json::JsonValue* price = item.find("price");
+                   const json::JsonValue* stock = item.find("stock");
+                   const json::JsonValue* name = item.find("name");
+                   if (price != nullptr && price->isNumber() &&
+                       price->asNumber() > 100 && stock != nullptr &&
+                       stock->isNumber() && stock->asNumber() < 10 &&
+                       !(name != nullptr && name->isString() &&
+                         name->asString() == "x"))
+                   {
+                       matches.push_back(&item);
+                   }
+               }
+               return matches.size();
+           });
+
+    // the readings stay packed, the query copies out what it selects
+    report("packed numbers", root, "$.readings[?(@ > 100)]", [&] {
+        std::vector<double> matches;
+        for (double reading : root.find("readings")->asNumberSpan()) {
+            if (reading > 100) {
+                matches.push_back(reading);
+            }
+        }
+        return matches.size();
+    });
+}
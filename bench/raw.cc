@@ -0,0 +1,62 @@
+// ParseOptions::rawDepth: rewriting the header of a big message and passing
+// its payload on, with the payload kept raw and with a full parse.
+
+#include "../json.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+// a header and about 18 MB of payload records
+std::string message()
+{
+    std::string source = R"({"to": "billing", "id": 7, "payload": [)";
+    for (size_t i = 0; i < 120000; ++i) {
+        if (i > 0) {
+            source += ",";
+        }
+        source += R"({"id": )" + std::to_string(i) +
+                  R"(, "name": "customer \")" + std::to_string(i) +
+                  R"(\"", "lines": [12.5, 3, 7.25, 100], "paid": false,)"
+                  R"( "address": {"street": "Main St", "city": "Springfield"}})";
+    }
+    return source + "]}";
+}
+
+double forward(const std::string& source, const json::ParseOptions& options,
+               size_t& written)
+{
+    auto start = std::chrono::steady_clock::now();
+    json::JsonValue value = json::parse(source, options);
+    value.asObject()["to"] = "archive";
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    written = os.view().size();
+    return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+int main()
+{
+    const std::string source = message();
+    std::printf("message: %.1f MB\n", static_cast<double>(source.size()) / 1e6);
+    for (size_t rawDepth : {0, 1}) {
+        json::ParseOptions options;
+        options.rawDepth = rawDepth;
+        double best = 1e9;
+        size_t written = 0;
+        for (int run = 0; run < 5; ++run) {
+            best = std::min(best, forward(source, options, written));
+        }
+        std::printf("%-12s %6.1f ms (%zu bytes out)\n",
+                    rawDepth == 0 ? "full parse" : "raw payload", best,
+                    written);
+    }
+}
@@ -0,0 +1,171 @@
+#include "bind.h"
+#include "detail.h"
+
+#include <sstream>
+
+namespace json
+{
+
+class detail::BindReader : public TokenReader
+{
+   public:
+    using TokenReader::TokenReader;
+};
+
+bool detail::readBool(BindReader& reader)
+{
+    bool value = reader.current.type == TokenType::True;
+    if (!value && reader.current.type != TokenType::False) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    reader.advance();
+    return value;
+}
+double detail::readNumber(BindReader& reader)
+{
+    if (reader.current.type != TokenType::Number) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    double value = 0;
+    if (auto code = parseNumber(reader.current.lexeme, value);
+        code != ErrorCode::None)
+    {
+        reader.fail(code);
+    }
+    reader.advance();
+    return value;
+}
+int64_t detail::readInteger(BindReader& reader, int64_t min, int64_t max)
+{
+    if (reader.current.type != TokenType::Number) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    std::string_view lexeme = reader.current.lexeme;
+    int64_t value = 0;
+    auto [ptr, ec] =
+      std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+    if (ec == std::errc::result_out_of_range) {
+        reader.fail(ErrorCode::NumberOutOfRange);
+    }
+    if (ec != std::errc() || ptr != lexeme.data() + lexeme.size()) {
+        // 1e3 or 2.0 are still integers
+        double number = 0;
+        if (auto code = parseNumber(lexeme, number); code != ErrorCode::None) {
+            reader.fail(code);
+        }
+        if (number != std::trunc(number)) {
+            reader.fail(ErrorCode::WrongType);
+        }
+        if (number < -0x1p63 || number >= 0x1p63) {
+            reader.fail(ErrorCode::NumberOutOfRange);
+        }
+        value = static_cast<int64_t>(number);
+    }
+    if (value < min || value > max) {
+        reader.fail(ErrorCode::NumberOutOfRange);
+    }
+    reader.advance();
+    return value;
+}
+void detail::readString(BindReader& reader, std::string& result)
+{
+    const Token& token = reader.current;
+    if (token.type != TokenType::String) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    if (token.escaped) {
+        unescapeString(token.lexeme, result);
+    } else {
+        result.assign(token.lexeme.substr(1, token.lexeme.size() - 2));
+    }
+    reader.advance();
+}
+JsonValue detail::readJsonValue(BindReader& reader)
+{
+    return reader.parseValue();
+}
+bool detail::readNull(BindReader& reader)
+{
+    if (reader.current.type != TokenType::Null) {
+        return false;
+    }
+    reader.advance();
+    return true;
+}
+void detail::readArray(BindReader& reader, void* target, ReadFunction element)
+{
+    if (reader.current.type != TokenType::LeftBracket) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    reader.advance();
+    if (reader.current.type == TokenType::RightBracket) {
+        reader.advance();
+        return;
+    }
+    while (true) {
+        element(reader, target);
+        if (reader.current.type == TokenType::RightBracket) {
+            reader.advance();
+            return;
+        }
+        reader.consume(TokenType::Comma, ErrorCode::ExpectedCommaOrBracket);
+    }
+}
+void detail::readObject(BindReader& reader, void* target,
+                        const FieldTable& table)
+{
+    if (reader.current.type != TokenType::LeftBrace) {
+        reader.fail(ErrorCode::WrongType);
+    }
+    reader.advance();
+    if (reader.current.type == TokenType::RightBrace) {
+        reader.advance();
+        return;
+    }
+    while (true) {
+        if (reader.current.type != TokenType::String) {
+            reader.fail(ErrorCode::ExpectedKey);
+        }
+        std::string_view key = reader.text();
+        const FieldSlot& slot =
+          table.slots[fieldHash(key, table.seed) & table.mask];
+        bool known = slot.read != nullptr && slot.key == key;
+        reader.advance();
+        reader.consume(TokenType::Colon, ErrorCode::ExpectedColon);
+        if (known) {
+            slot.read(reader, target);
+        } else {
+            reader.skipValue();
+        }
+        if (reader.current.type == TokenType::RightBrace) {
+            reader.advance();
+            return;
+        }
+        reader.consume(TokenType::Comma, ErrorCode::ExpectedCommaOrBrace);
+    }
+}
+void detail::readRoot(std::string_view source, void* target, ReadFunction read)
+{
+    BindReader reader(source);
+    read(reader, target);
+    if (reader.current.type != TokenType::EndOfFile) {
+        reader.fail(ErrorCode::TrailingContent);
+    }
+}
+
+void detail::writeString(std::string& out, std::string_view value)
+{
+    writeEscapedString(value, out);
+}
+void detail::writeNumber(std::string& out, double value)
+{
+    writeShortestNumber(value, out);
+}
+void detail::writeJsonValue(std::string& out, const JsonValue& value)
+{
+    std::ostringstream os;
+    serialiseCompact(value, os);
+    out += os.view();
+}
+
+} // namespace json
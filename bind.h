@@ -0,0 +1,371 @@
+#pragma once
+
+#include "json.h"
+#include "scalars.h"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// reading JSON straight into your own structs, without building a JsonValue
+// first. describe the members once:
+//
+//   struct Trade { std::string symbol; double price; int64_t qty; };
+//
+//   template <>
+//   struct json::Binding<Trade>
+//   {
+//       static constexpr auto fields =
+//         std::tuple{json::field("symbol", &Trade::symbol),
+//                    json::field("price", &Trade::price),
+//                    json::field("qty", &Trade::qty)};
+//   };
+//
+//   Trade trade = json::parseInto<Trade>(R"({"symbol": "X", ...})");
+//
+// members can be bool, any integer or floating point type, std::string,
+// JsonValue, std::optional and std::vector of those, and other structs with
+// a Binding. the values of keys with no field are skipped without being
+// stored (arrays and objects there are only checked for balanced brackets
+// and closed strings and comments, like with a Projection), fields with no
+// key keep whatever they had. JsonValue fields are parsed in the same pass.
+//
+// json::serialiseStruct(trade) goes the other way.
+
+namespace json
+{
+
+// specialise this with a static constexpr `fields` tuple of json::field()s
+template <typename T>
+struct Binding;
+
+template <typename T, typename Member>
+struct Field
+{
+    std::string_view key;
+    Member T::*member;
+};
+
+template <typename T, typename Member>
+constexpr Field<T, Member> field(std::string_view key, Member T::*member)
+{
+    return {key, member};
+}
+
+namespace detail
+{
+
+// the parser state, lives in bind.cc
+class BindReader;
+
+using ReadFunction = void (*)(BindReader&, void*);
+
+struct FieldSlot
+{
+    std::string_view key;
+    // nullptr for an empty slot
+    ReadFunction read = nullptr;
+};
+
+// a perfect hash from key to field: no two keys share a slot, so a lookup is
+// one hash and one comparison
+struct FieldTable
+{
+    const FieldSlot* slots;
+    uint64_t mask;
+    uint64_t seed;
+};
+
+constexpr uint64_t fieldHash(std::string_view key, uint64_t seed)
+{
+    uint64_t hash = 0xcbf29ce484222325 ^ seed;
+    for (char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// these read the current value (or fail with a ParsingError) and move past it
+bool readBool(BindReader& reader);
+double readNumber(BindReader& reader);
+// !!fails with WrongType if the number has a fraction, NumberOutOfRange if
+// it's outside [min, max]!!
+int64_t readInteger(BindReader& reader, int64_t min, int64_t max);
+void readString(BindReader& reader, std::string& result);
+JsonValue readJsonValue(BindReader& reader);
+// moves past a null and returns true, or returns false and stays put
+bool readNull(BindReader& reader);
+// calls element(reader, target) for each element, with the reader on it
+void readArray(BindReader& reader, void* target, ReadFunction element);
+void readObject(BindReader& reader, void* target, const FieldTable& table);
+// !!throws ParsingError!!
+void readRoot(std::string_view source, void* target, ReadFunction read);
+
+template <typename T>
+concept Bound = requires { Binding<T>::fields; };
+
+template <typename T>
+struct IsOptional : std::false_type
+{
+};
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type
+{
+};
+template <typename T>
+struct IsVector : std::false_type
+{
+};
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type
+{
+};
+
+template <typename T>
+void read(BindReader& reader, T& out);
+
+template <Bound T>
+constexpr size_t fieldCount =
+  std::tuple_size_v<std::remove_cvref_t<decltype(Binding<T>::fields)>>;
+
+template <Bound T>
+constexpr std::array<std::string_view, fieldCount<T>> fieldKeys =
+  []<size_t... I>(std::index_sequence<I...>) {
+      return std::array<std::string_view, fieldCount<T>>{
+        std::get<I>(Binding<T>::fields).key...};
+  }(std::make_index_sequence<fieldCount<T>>());
+
+template <Bound T>
+class ObjectTable
+{
+    static constexpr auto& fields = Binding<T>::fields;
+    static constexpr size_t count = fieldCount<T>;
+    static constexpr auto& keys = fieldKeys<T>;
+
+    static constexpr bool collisionFree(size_t size, uint64_t seed)
+    {
+        std::array<bool, 1024> used{};
+        for (std::string_view key : keys) {
+            size_t slot = fieldHash(key, seed) & (size - 1);
+            if (used[slot]) {
+                return false;
+            }
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    // the smallest table (at least twice the fields) and the first seed
+    // that gives every key its own slot
+    static constexpr std::pair<size_t, uint64_t> layout = [] {
+        for (size_t size = std::bit_ceil(std::max<size_t>(2 * count, 1));
+             size <= 1024; size *= 2)
+        {
+            for (uint64_t seed = 0; seed < 4096; ++seed) {
+                if (collisionFree(size, seed)) {
+                    return std::pair{size, seed};
+                }
+            }
+        }
+        return std::pair<size_t, uint64_t>{0, 0};
+    }();
+    static_assert(layout.first != 0,
+                  "json::Binding: no perfect hash for these keys (duplicate "
+                  "keys, or more than 512 fields?)");
+
+    template <size_t I>
+    static void readField(BindReader& reader, void* target)
+    {
+        read(reader, static_cast<T*>(target)->*std::get<I>(fields).member);
+    }
+
+    static constexpr std::array<FieldSlot, layout.first> slots =
+      []<size_t... I>(std::index_sequence<I...>) {
+          std::array<FieldSlot, layout.first> result{};
+          ((result[fieldHash(keys[I], layout.second) & (layout.first - 1)] =
+              FieldSlot{keys[I], &readField<I>}),
+           ...);
+          return result;
+      }(std::make_index_sequence<count>());
+
+   public:
+    static constexpr FieldTable table{slots.data(), layout.first - 1,
+                                      layout.second};
+};
+
+template <typename T>
+void read(BindReader& reader, T& out)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        out = readBool(reader);
+    } else if constexpr (std::is_integral_v<T>) {
+        constexpr int64_t min = std::numeric_limits<T>::min();
+        constexpr int64_t max = std::in_range<int64_t>(
+                                  std::numeric_limits<T>::max())
+                                  ? static_cast<int64_t>(
+                                      std::numeric_limits<T>::max())
+                                  : std::numeric_limits<int64_t>::max();
+        out = static_cast<T>(readInteger(reader, min, max));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        out = static_cast<T>(readNumber(reader));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        readString(reader, out);
+    } else if constexpr (std::is_same_v<T, JsonValue>) {
+        out = readJsonValue(reader);
+    } else if constexpr (IsOptional<T>::value) {
+        if (readNull(reader)) {
+            out.reset();
+        } else {
+            read(reader, out ? *out : out.emplace());
+        }
+    } else if constexpr (IsVector<T>::value) {
+        out.clear();
+        readArray(reader, &out, [](BindReader& reader, void* target) {
+            read(reader, static_cast<T*>(target)->emplace_back());
+        });
+    } else if constexpr (Bound<T>) {
+        readObject(reader, &out, ObjectTable<T>::table);
+    } else {
+        static_assert(sizeof(T) == 0, "json::parseInto: unsupported type");
+    }
+}
+
+// these append value to out
+void writeString(std::string& out, std::string_view value);
+void writeNumber(std::string& out, double value);
+void writeJsonValue(std::string& out, const JsonValue& value);
+
+// what goes in front of each member's value, already escaped: {"a": then
+// ,"b": and so on
+template <Bound T>
+class KeyFragments
+{
+    static constexpr auto& keys = fieldKeys<T>;
+
+    static constexpr std::array<size_t, keys.size() + 1> offsets = [] {
+        std::array<size_t, keys.size() + 1> result{};
+        for (size_t i = 0; i < keys.size(); ++i) {
+            // the brace or comma, two quotes and the colon
+            size_t escaped = 0;
+            writeEscaped(keys[i], [&](const char*, size_t length) {
+                escaped += length;
+            });
+            result[i + 1] = result[i] + escaped + 4;
+        }
+        return result;
+    }();
+
+    static constexpr std::array<char, offsets.back()> bytes = [] {
+        std::array<char, offsets.back()> result{};
+        char* out = result.data();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            *out++ = i == 0 ? '{' : ',';
+            *out++ = '"';
+            writeEscaped(keys[i], [&](const char* from, size_t length) {
+                for (size_t c = 0; c < length; ++c) {
+                    *out++ = from[c];
+                }
+            });
+            *out++ = '"';
+            *out++ = ':';
+        }
+        return result;
+    }();
+
+   public:
+    template <size_t I>
+    static constexpr std::string_view fragment =
+      std::string_view(bytes.data() + offsets[I], offsets[I + 1] - offsets[I]);
+};
+
+template <typename T>
+void write(std::string& out, const T& value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        out += value ? "true" : "false";
+    } else if constexpr (std::is_integral_v<T>) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr - buffer);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        writeNumber(out, static_cast<double>(value));
+    } else if constexpr (std::is_null_pointer_v<T>) {
+        out += "null";
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        writeString(out, value);
+    } else if constexpr (std::is_same_v<T, JsonValue>) {
+        writeJsonValue(out, value);
+    } else if constexpr (IsOptional<T>::value) {
+        if (value) {
+            write(out, *value);
+        } else {
+            out += "null";
+        }
+    } else if constexpr (IsVector<T>::value) {
+        out += '[';
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            write(out, value[i]);
+        }
+        out += ']';
+    } else if constexpr (Bound<T>) {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((out += KeyFragments<T>::template fragment<I>,
+              write(out, value.*std::get<I>(Binding<T>::fields).member)),
+             ...);
+        }(std::make_index_sequence<fieldCount<T>>());
+        out += fieldCount<T> == 0 ? "{}" : "}";
+    } else {
+        static_assert(sizeof(T) == 0, "json::serialiseStruct: unsupported type");
+    }
+}
+
+} // namespace detail
+
+// parses source into out, overwriting the fields it has keys for.
+// !!throws ParsingError on invalid input or a value of the wrong type!!
+template <typename T>
+void parseInto(std::string_view source, T& out)
+{
+    detail::readRoot(source, &out, [](detail::BindReader& reader, void* target) {
+        detail::read(reader, *static_cast<T*>(target));
+    });
+}
+
+// !!throws ParsingError on invalid input or a value of the wrong type!!
+template <typename T>
+[[nodiscard]] T parseInto(std::string_view source)
+{
+    T result{};
+    parseInto(source, result);
+    return result;
+}
+
+// appends value to out as compact JSON, members in Binding order
+template <typename T>
+void serialiseStruct(const T& value, std::string& out)
+{
+    detail::write(out, value);
+}
+
+template <typename T>
+[[nodiscard]] std::string serialiseStruct(const T& value)
+{
+    std::string result;
+    detail::write(result, value);
+    return result;
+}
+
+} // namespace json
@@ -0,0 +1,447 @@
+#include "columns.h"
+#include "detail.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace json
+{
+
+namespace
+{
+
+std::vector<Column> emptyColumns(const std::vector<ColumnSpec>& schema,
+                                 size_t expectedRows)
+{
+    std::vector<Column> columns(schema.size());
+    for (size_t i = 0; i < schema.size(); ++i) {
+        Column& column = columns[i];
+        column.type = schema[i].type;
+        column.validity.reserve((expectedRows + 63) / 64);
+        switch (column.type) {
+            case ColumnType::Number:
+                column.numbers.reserve(expectedRows);
+                break;
+            case ColumnType::Integer:
+                column.integers.reserve(expectedRows);
+                break;
+            case ColumnType::Bool: column.bools.reserve(expectedRows); break;
+            case ColumnType::String:
+                column.offsets.reserve(expectedRows + 1);
+                column.offsets.push_back(0);
+                break;
+        }
+    }
+    return columns;
+}
+
+// every column gets a null for the row, which setting a value then
+// overwrites
+void startRow(std::vector<Column>& columns)
+{
+    for (Column& column : columns) {
+        if (column.rows % 64 == 0) {
+            column.validity.push_back(0);
+        }
+        switch (column.type) {
+            case ColumnType::Number: column.numbers.push_back(0); break;
+            case ColumnType::Integer: column.integers.push_back(0); break;
+            case ColumnType::Bool: column.bools.push_back(0); break;
+            case ColumnType::String: break; // in endRow
+        }
+        column.rows++;
+    }
+}
+void endRow(std::vector<Column>& columns)
+{
+    for (Column& column : columns) {
+        if (column.type == ColumnType::String) {
+            column.offsets.push_back(column.chars.size());
+        }
+    }
+}
+void setValid(Column& column)
+{
+    size_t row = column.rows - 1;
+    column.validity.back() |= uint64_t{1} << (row % 64);
+}
+// the row's value back to null, dropping its characters if it had any
+void clearValid(Column& column)
+{
+    size_t row = column.rows - 1;
+    column.validity.back() &= ~(uint64_t{1} << (row % 64));
+    if (column.type == ColumnType::String) {
+        column.chars.resize(column.offsets.back());
+    }
+}
+
+// number as an int64_t, if it is a whole number that fits in one
+bool exactInteger(double number, int64_t& result)
+{
+    if (number != std::trunc(number) || number < -0x1p63 || number >= 0x1p63) {
+        return false;
+    }
+    result = static_cast<int64_t>(number);
+    return true;
+}
+
+// for parseColumns: the pointers' segments as a tree, so a record is read
+// by following it down
+struct PointerNode
+{
+    Pointer::Segment segment;
+    std::vector<PointerNode> children;
+    // the columns whose pointer ends here
+    std::vector<size_t> columns;
+
+    PointerNode& child(const Pointer::Segment& segment)
+    {
+        for (PointerNode& node : children) {
+            if (node.segment.key == segment.key) {
+                return node;
+            }
+        }
+        PointerNode& node = children.emplace_back();
+        node.segment = segment;
+        return node;
+    }
+    [[nodiscard]] const PointerNode* member(std::string_view key) const
+    {
+        for (const PointerNode& node : children) {
+            if (node.segment.key == key) {
+                return &node;
+            }
+        }
+        return nullptr;
+    }
+    [[nodiscard]] const PointerNode* element(size_t index) const
+    {
+        for (const PointerNode& node : children) {
+            if (node.segment.index == index) {
+                return &node;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class ColumnReader
+{
+    detail::TokenReader reader;
+    std::vector<Column>& columns;
+
+    // sets the columns from the current token, if it's a scalar of their
+    // type. doesn't advance.
+    void setColumns(const std::vector<size_t>& targets);
+    // sets node's columns and all those below it back to null, so that when
+    // a key repeats the last value wins, like it does in json::parse
+    void clearColumns(const PointerNode& node);
+    void readValue(const PointerNode& node);
+
+   public:
+    ColumnReader(std::string_view source, std::vector<Column>& columns)
+      : reader(source), columns(columns)
+    {
+    }
+
+    void read(const PointerNode& root);
+};
+
+void ColumnReader::setColumns(const std::vector<size_t>& targets)
+{
+    for (size_t target : targets) {
+        Column& column = columns[target];
+        const auto type = reader.current.type;
+        const auto lexeme = reader.current.lexeme;
+        switch (column.type) {
+            case ColumnType::Number: {
+                if (type != detail::TokenType::Number) {
+                    break;
+                }
+                double number = 0;
+                if (auto code = detail::parseNumber(lexeme, number);
+                    code != ErrorCode::None)
+                {
+                    reader.fail(code);
+                }
+                column.numbers.back() = number;
+                setValid(column);
+                break;
+            }
+            case ColumnType::Integer: {
+                if (type != detail::TokenType::Number) {
+                    break;
+                }
+                int64_t integer = 0;
+                auto [ptr, ec] = std::from_chars(
+                  lexeme.data(), lexeme.data() + lexeme.size(), integer);
+                if (ec == std::errc::result_out_of_range) {
+                    break;
+                }
+                if (ec != std::errc() || ptr != lexeme.data() + lexeme.size()) {
+                    // 1e3 or 2.0
+                    double number = 0;
+                    if (auto code = detail::parseNumber(lexeme, number);
+                        code != ErrorCode::None)
+                    {
+                        reader.fail(code);
+                    }
+                    if (!exactInteger(number, integer)) {
+                        break;
+                    }
+                }
+                column.integers.back() = integer;
+                setValid(column);
+                break;
+            }
+            case ColumnType::Bool:
+                if (type == detail::TokenType::True ||
+                    type == detail::TokenType::False)
+                {
+                    column.bools.back() =
+                      static_cast<uint8_t>(type == detail::TokenType::True);
+                    setValid(column);
+                }
+                break;
+            case ColumnType::String:
+                if (type != detail::TokenType::String) {
+                    break;
+                }
+                column.chars += reader.text();
+                setValid(column);
+                break;
+        }
+    }
+}
+void ColumnReader::clearColumns(const PointerNode& node)
+{
+    for (size_t target : node.columns) {
+        clearValid(columns[target]);
+    }
+    for (const PointerNode& child : node.children) {
+        clearColumns(child);
+    }
+}
+void ColumnReader::readValue(const PointerNode& node)
+{
+    if (reader.current.type == detail::TokenType::LeftBrace &&
+        !node.children.empty())
+    {
+        reader.advance();
+        if (reader.current.type == detail::TokenType::RightBrace) {
+            reader.advance();
+            return;
+        }
+        while (true) {
+            if (reader.current.type != detail::TokenType::String) {
+                reader.fail(ErrorCode::ExpectedKey);
+            }
+            const PointerNode* child = node.member(reader.text());
+            reader.advance();
+            reader.consume(detail::TokenType::Colon,
+                           ErrorCode::ExpectedColon);
+            if (child != nullptr) {
+                clearColumns(*child);
+                readValue(*child);
+            } else {
+                reader.skipValue();
+            }
+            if (reader.current.type == detail::TokenType::RightBrace) {
+                reader.advance();
+                return;
+            }
+            reader.consume(detail::TokenType::Comma,
+                           ErrorCode::ExpectedCommaOrBrace);
+        }
+    }
+    if (reader.current.type == detail::TokenType::LeftBracket &&
+        !node.children.empty())
+    {
+        reader.advance();
+        if (reader.current.type == detail::TokenType::RightBracket) {
+            reader.advance();
+            return;
+        }
+        for (size_t index = 0;; ++index) {
+            if (const PointerNode* child = node.element(index)) {
+                readValue(*child);
+            } else {
+                reader.skipValue();
+            }
+            if (reader.current.type == detail::TokenType::RightBracket) {
+                reader.advance();
+                return;
+            }
+            reader.consume(detail::TokenType::Comma,
+                           ErrorCode::ExpectedCommaOrBracket);
+        }
+    }
+    setColumns(node.columns);
+    reader.skipValue();
+}
+void ColumnReader::read(const PointerNode& root)
+{
+    reader.consume(detail::TokenType::LeftBracket,
+                   ErrorCode::ExpectedArrayStart);
+    if (reader.current.type == detail::TokenType::RightBracket) {
+        reader.advance();
+    } else {
+        while (true) {
+            startRow(columns);
+            readValue(root);
+            endRow(columns);
+            if (reader.current.type == detail::TokenType::RightBracket) {
+                reader.advance();
+                break;
+            }
+            reader.consume(detail::TokenType::Comma,
+                           ErrorCode::ExpectedCommaOrBracket);
+        }
+    }
+    if (reader.current.type != detail::TokenType::EndOfFile) {
+        reader.fail(ErrorCode::TrailingContent);
+    }
+}
+
+// the value at pointer in record, nullptr if there isn't one. an element
+// of a packed array is copied into packed, like Query::resolve() does,
+// rather than going through the copy of the whole array find() would make
+const JsonValue* resolve(const JsonValue& record, const Pointer& pointer,
+                         JsonValue& packed)
+{
+    const JsonValue* value = &record;
+    for (const auto& segment : pointer.segments()) {
+        if (value->isNumberArray()) {
+            auto numbers = value->asNumberSpan();
+            if (!segment.index || *segment.index >= numbers.size()) {
+                return nullptr;
+            }
+            packed = JsonValue(numbers[*segment.index]);
+            value = &packed;
+        } else if (value->isArray()) {
+            const JsonArray& elements = value->asArray();
+            if (!segment.index || *segment.index >= elements.size()) {
+                return nullptr;
+            }
+            value = &elements[*segment.index];
+        } else if (value->isObject()) {
+            const JsonObject& object = value->asObject();
+            auto it = object.find(segment.key, segment.hash);
+            if (it == object.end()) {
+                return nullptr;
+            }
+            value = &it->second;
+        } else {
+            return nullptr;
+        }
+    }
+    return value;
+}
+
+// fills in the current row from record
+void fillRow(std::vector<Column>& columns, const std::vector<Pointer>& pointers,
+             const JsonValue& record)
+{
+    JsonValue packed;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const JsonValue* value = resolve(record, pointers[i], packed);
+        if (value == nullptr) {
+            continue;
+        }
+        Column& column = columns[i];
+        switch (column.type) {
+            case ColumnType::Number:
+                if (value->isNumber()) {
+                    column.numbers.back() = value->asNumber();
+                    setValid(column);
+                }
+                break;
+            case ColumnType::Integer:
+                if (value->isNumber() &&
+                    exactInteger(value->asNumber(), column.integers.back()))
+                {
+                    setValid(column);
+                }
+                break;
+            case ColumnType::Bool:
+                if (value->isBool()) {
+                    column.bools.back() = static_cast<uint8_t>(value->asBool());
+                    setValid(column);
+                }
+                break;
+            case ColumnType::String:
+                if (value->isString()) {
+                    column.chars += value->asString();
+                    setValid(column);
+                }
+                break;
+        }
+    }
+}
+
+} // namespace
+
+bool Column::valid(size_t row) const
+{
+    return ((validity[row / 64] >> (row % 64)) & 1) != 0;
+}
+std::string_view Column::string(size_t row) const
+{
+    return std::string_view(chars).substr(offsets[row],
+                                          offsets[row + 1] - offsets[row]);
+}
+
+std::vector<Column> toColumns(const JsonValue& array,
+                              const std::vector<ColumnSpec>& schema)
+{
+    if (!array.isArray()) {
+        detail::raise(std::invalid_argument("toColumns: not an array"));
+    }
+    std::vector<Pointer> pointers;
+    pointers.reserve(schema.size());
+    for (const ColumnSpec& spec : schema) {
+        pointers.emplace_back(spec.pointer);
+    }
+
+    if (array.isNumberArray()) {
+        // the elements of a packed array are numbers, so only an empty
+        // pointer finds anything in them
+        auto numbers = array.asNumberSpan();
+        std::vector<Column> columns = emptyColumns(schema, numbers.size());
+        for (double number : numbers) {
+            startRow(columns);
+            fillRow(columns, pointers, JsonValue(number));
+            endRow(columns);
+        }
+        return columns;
+    }
+    const JsonArray& records = array.asArray();
+    std::vector<Column> columns = emptyColumns(schema, records.size());
+    for (const JsonValue& record : records) {
+        startRow(columns);
+        fillRow(columns, pointers, record);
+        endRow(columns);
+    }
+    return columns;
+}
+
+std::vector<Column> parseColumns(std::string_view source,
+                                 const std::vector<ColumnSpec>& schema)
+{
+    PointerNode root;
+    for (size_t i = 0; i < schema.size(); ++i) {
+        Pointer pointer(schema[i].pointer);
+        PointerNode* node = &root;
+        for (const auto& segment : pointer.segments()) {
+            node = &node->child(segment);
+        }
+        node->columns.push_back(i);
+    }
+
+    std::vector<Column> columns = emptyColumns(schema, 0);
+    ColumnReader(source, columns).read(root);
+    return columns;
+}
+
+} // namespace json
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// arrays of records turned into columns: one contiguous array per field,
+// for code that wants to loop over all the timestamps or all the prices
+// (and have the compiler vectorise the loop) rather than walk objects.
+//
+//   auto columns = json::toColumns(readings, {{"/ts", json::ColumnType::Integer},
+//                                             {"/v", json::ColumnType::Number}});
+//   std::span<const double> values = columns[1].numbers;
+
+namespace json
+{
+
+enum class ColumnType : uint8_t {
+    Number,
+    // numbers with no fractional part that fit in an int64_t
+    Integer,
+    Bool,
+    String
+};
+
+struct ColumnSpec
+{
+    // where the value is in each record, as a JSON Pointer ("/user/id")
+    std::string pointer;
+    ColumnType type;
+};
+
+// one buffer per type, only the column type's is filled in (with one entry
+// per row, except offsets which has one more). rows that don't have a value
+// of that type at the pointer are null: their validity bit is clear and
+// they hold 0, false or "".
+struct Column
+{
+    ColumnType type;
+    size_t rows = 0;
+    // bit row % 64 of validity[row / 64], set if the row isn't null
+    std::vector<uint64_t> validity;
+
+    std::vector<double> numbers;
+    std::vector<int64_t> integers;
+    // 0 or 1
+    std::vector<uint8_t> bools;
+    // the strings back to back, row i is chars[offsets[i], offsets[i + 1])
+    std::vector<uint64_t> offsets;
+    std::string chars;
+
+    [[nodiscard]] bool valid(size_t row) const;
+    [[nodiscard]] std::string_view string(size_t row) const;
+};
+
+// one column per spec in schema, and a row per element of array, in a
+// single pass over it. elements that aren't objects give rows of nulls.
+// !!throws std::invalid_argument if array isn't an array or a pointer isn't
+// valid!!
+[[nodiscard]] std::vector<Column> toColumns(const JsonValue& array,
+                                            const std::vector<ColumnSpec>& schema);
+
+// the same straight from the text of an array, without building any values:
+// what's at the pointers is read into the columns as it's lexed and
+// everything else is skipped over. like parse with a Projection, skipped
+// arrays and objects are only checked for balanced brackets (of the right
+// kinds) and closed strings and comments.
+// !!throws ParsingError on invalid input (or if it isn't an array),
+// std::invalid_argument if a pointer isn't valid!!
+[[nodiscard]] std::vector<Column> parseColumns(
+  std::string_view source, const std::vector<ColumnSpec>& schema);
+
+} // namespace json
@@ -0,0 +1,483 @@
+#include "compact.h"
+#include "detail.h"
+
+namespace json
+{
+
+class CompactParser
+{
+    detail::Lexer lexer;
+    detail::Token currentToken;
+    const char* origin;
+
+    CompactParser(std::string_view source);
+
+    // !!throws ParsingError!!
+    [[noreturn]] void fail(ErrorCode code);
+    void advance();
+    void consume(detail::TokenType type, ErrorCode code);
+    CompactValue parseValue();
+    CompactValue parseObject();
+    CompactValue parseArray();
+
+   public:
+    static CompactValue parse(std::string_view source);
+};
+
+CompactValue parseCompact(std::string_view source)
+{
+    return CompactParser::parse(source);
+}
+
+uint8_t CompactValue::tag() const
+{
+    return static_cast<uint8_t>(bytes[15]);
+}
+void CompactValue::setTag(Type type, bool heapString)
+{
+    bytes[15] = static_cast<std::byte>(static_cast<uint8_t>(type) |
+                                       (heapString ? heapStringFlag : 0));
+}
+bool CompactValue::hasHeapString() const
+{
+    return (tag() & heapStringFlag) != 0;
+}
+void CompactValue::setString(std::string_view s)
+{
+    if (s.length() <= maxInlineString) {
+        std::memcpy(bytes, s.data(), s.length());
+        bytes[14] = static_cast<std::byte>(s.length());
+        setTag(Type::String);
+    } else {
+        setPayload(new std::string(s));
+        setTag(Type::String, true);
+    }
+}
+template <typename Container>
+void CompactValue::setContainer(Type type, Container&& container)
+{
+    using Stored = std::remove_cvref_t<Container>;
+    setPayload(container.empty()
+                 ? nullptr
+                 : new Stored(std::forward<Container>(container)));
+    setTag(type);
+}
+void CompactValue::copyFrom(const CompactValue& other)
+{
+    switch (other.type()) {
+        case Type::String:
+            if (other.hasHeapString()) {
+                setString(other.asString());
+                return;
+            }
+            break;
+        case Type::Array: setContainer(Type::Array, other.asArray()); return;
+        case Type::Object:
+            setContainer(Type::Object, other.asObject());
+            return;
+        default: break;
+    }
+    // everything else is plain bytes
+    std::memcpy(bytes, other.bytes, sizeof(bytes));
+}
+void CompactValue::destroy()
+{
+    switch (type()) {
+        case Type::String:
+            if (hasHeapString()) {
+                delete payload<std::string*>();
+            }
+            break;
+        case Type::Array: delete payload<CompactArray*>(); break;
+        case Type::Object: delete payload<CompactObject*>(); break;
+        default: break;
+    }
+}
+CompactValue::CompactValue(std::nullptr_t) : bytes()
+{
+    setTag(Type::Null);
+}
+CompactValue::CompactValue(bool b) : bytes()
+{
+    setPayload(b);
+    setTag(Type::Bool);
+}
+CompactValue::CompactValue(double d) : bytes()
+{
+    setPayload(d);
+    setTag(Type::Number);
+}
+CompactValue::CompactValue(int i) : CompactValue(static_cast<double>(i))
+{
+}
+CompactValue::CompactValue(std::string_view s) : bytes()
+{
+    setString(s);
+}
+CompactValue::CompactValue(const std::string& s)
+  : CompactValue(std::string_view(s))
+{
+}
+CompactValue::CompactValue(const char* s) : CompactValue(std::string_view(s))
+{
+}
+CompactValue::CompactValue(CompactArray a) : bytes()
+{
+    setContainer(Type::Array, std::move(a));
+}
+CompactValue::CompactValue(CompactObject o) : bytes()
+{
+    setContainer(Type::Object, std::move(o));
+}
+CompactValue::CompactValue(const CompactValue& other) : bytes()
+{
+    copyFrom(other);
+}
+CompactValue::CompactValue(CompactValue&& other) noexcept : bytes()
+{
+    // steal whatever other points to and leave it null
+    std::memcpy(bytes, other.bytes, sizeof(bytes));
+    other.setTag(Type::Null);
+}
+CompactValue& CompactValue::operator=(const CompactValue& other)
+{
+    if (this != &other) {
+        CompactValue copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+CompactValue& CompactValue::operator=(CompactValue&& other) noexcept
+{
+    if (this != &other) {
+        destroy();
+        std::memcpy(bytes, other.bytes, sizeof(bytes));
+        other.setTag(Type::Null);
+    }
+    return *this;
+}
+CompactValue::~CompactValue()
+{
+    destroy();
+}
+CompactValue::Type CompactValue::type() const
+{
+    return static_cast<Type>(tag() & ~heapStringFlag);
+}
+bool CompactValue::isNull() const
+{
+    return type() == Type::Null;
+}
+bool CompactValue::isBool() const
+{
+    return type() == Type::Bool;
+}
+bool CompactValue::isNumber() const
+{
+    return type() == Type::Number;
+}
+bool CompactValue::isString() const
+{
+    return type() == Type::String;
+}
+bool CompactValue::isArray() const
+{
+    return type() == Type::Array;
+}
+bool CompactValue::isObject() const
+{
+    return type() == Type::Object;
+}
+bool CompactValue::asBool() const
+{
+    if (!isBool()) {
+        detail::raise(std::bad_variant_access());
+    }
+    return payload<bool>();
+}
+double CompactValue::asNumber() const
+{
+    if (!isNumber()) {
+        detail::raise(std::bad_variant_access());
+    }
+    return payload<double>();
+}
+std::string_view CompactValue::asString() const
+{
+    if (!isString()) {
+        detail::raise(std::bad_variant_access());
+    }
+    if (hasHeapString()) {
+        return *payload<const std::string*>();
+    }
+    return {reinterpret_cast<const char*>(bytes),
+            static_cast<size_t>(bytes[14])};
+}
+CompactArray& CompactValue::asArray()
+{
+    if (!isArray()) {
+        detail::raise(std::bad_variant_access());
+    }
+    // empty arrays don't have a container yet, make one now that someone
+    // might add to it
+    if (payload<CompactArray*>() == nullptr) {
+        setPayload(new CompactArray());
+    }
+    return *payload<CompactArray*>();
+}
+CompactObject& CompactValue::asObject()
+{
+    if (!isObject()) {
+        detail::raise(std::bad_variant_access());
+    }
+    if (payload<CompactObject*>() == nullptr) {
+        setPayload(new CompactObject());
+    }
+    return *payload<CompactObject*>();
+}
+const CompactArray& CompactValue::asArray() const
+{
+    if (!isArray()) {
+        detail::raise(std::bad_variant_access());
+    }
+    static const CompactArray emptyArray;
+    const auto* array = payload<const CompactArray*>();
+    return array != nullptr ? *array : emptyArray;
+}
+const CompactObject& CompactValue::asObject() const
+{
+    if (!isObject()) {
+        detail::raise(std::bad_variant_access());
+    }
+    static const CompactObject emptyObject;
+    const auto* object = payload<const CompactObject*>();
+    return object != nullptr ? *object : emptyObject;
+}
+const CompactValue* CompactValue::find(std::string_view key) const
+{
+    if (!isObject()) {
+        return nullptr;
+    }
+    // later duplicates win, same as when parsing into a JsonObject
+    const auto& members = asObject();
+    for (size_t i = members.size(); i-- > 0;) {
+        if (members[i].key.asString() == key) {
+            return &members[i].value;
+        }
+    }
+    return nullptr;
+}
+CompactValue* CompactValue::find(std::string_view key)
+{
+    return const_cast<CompactValue*>(std::as_const(*this).find(key));
+}
+CompactValue CompactValue::from(const JsonValue& original)
+{
+    // so a raw packed array stays packed
+    const JsonValue& value = original.materialize();
+    if (value.isBool()) {
+        return {value.asBool()};
+    }
+    if (value.isNumber()) {
+        return {value.asNumber()};
+    }
+    if (value.isString()) {
+        return {value.asString()};
+    }
+    if (value.isNumberArray()) {
+        auto numbers = value.asNumberSpan();
+        return {CompactArray(numbers.begin(), numbers.end())};
+    }
+    if (value.isArray()) {
+        CompactArray array;
+        array.reserve(value.asArray().size());
+        for (const auto& element : value.asArray()) {
+            array.push_back(from(element));
+        }
+        return {std::move(array)};
+    }
+    if (value.isObject()) {
+        CompactObject object;
+        object.reserve(value.asObject().size());
+        for (const auto& [key, member] : value.asObject()) {
+            object.push_back({.key = key, .value = from(member)});
+        }
+        return {std::move(object)};
+    }
+    return {nullptr};
+}
+JsonValue CompactValue::toJsonValue() const
+{
+    return visit([](const auto& arg) -> JsonValue {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return {std::string(arg)};
+        } else if constexpr (std::is_same_v<T, CompactArray>) {
+            JsonArray array;
+            array.reserve(arg.size());
+            for (const auto& element : arg) {
+                array.push_back(element.toJsonValue());
+            }
+            return {std::move(array)};
+        } else if constexpr (std::is_same_v<T, CompactObject>) {
+            JsonObject object;
+            for (const auto& member : arg) {
+                object[std::string(member.key.asString())] =
+                  member.value.toJsonValue();
+            }
+            return {std::move(object)};
+        } else {
+            return {arg};
+        }
+    });
+}
+CompactParser::CompactParser(std::string_view source)
+  : lexer(detail::skipByteOrderMark(source)), origin(source.data())
+{
+    advance();
+}
+void CompactParser::fail(ErrorCode code)
+{
+    detail::raise(ParsingError(ParseError{
+      .code = code,
+      .offset = static_cast<size_t>(currentToken.lexeme.data() - origin),
+      .line = currentToken.line,
+      .col = currentToken.col}));
+}
+void CompactParser::advance()
+{
+    currentToken = lexer.nextToken();
+    if (currentToken.type == detail::TokenType::Unknown) {
+        fail(lexer.error());
+    }
+}
+void CompactParser::consume(detail::TokenType type, ErrorCode code)
+{
+    if (currentToken.type == type) {
+        advance();
+        return;
+    }
+    fail(code);
+}
+CompactValue CompactParser::parseValue()
+{
+    switch (currentToken.type) {
+        case detail::TokenType::LeftBrace: return parseObject();
+        case detail::TokenType::LeftBracket: return parseArray();
+        case detail::TokenType::String: {
+            CompactValue value(detail::unescapeString(currentToken.lexeme));
+            advance();
+            return value;
+        }
+        case detail::TokenType::Number: {
+            double number = 0;
+            if (auto code = detail::parseNumber(currentToken.lexeme, number);
+                code != ErrorCode::None)
+            {
+                fail(code);
+            }
+            advance();
+            return {number};
+        }
+        case detail::TokenType::True: advance(); return {true};
+        case detail::TokenType::False: advance(); return {false};
+        case detail::TokenType::Null: advance(); return {nullptr};
+        default: fail(ErrorCode::ExpectedValue);
+    }
+}
+CompactValue CompactParser::parseObject()
+{
+    consume(detail::TokenType::LeftBrace, ErrorCode::ExpectedObjectStart);
+    CompactObject object;
+
+    if (currentToken.type != detail::TokenType::RightBrace) {
+        while (true) {
+            if (currentToken.type != detail::TokenType::String) {
+                fail(ErrorCode::ExpectedKey);
+            }
+            CompactValue key(detail::unescapeString(currentToken.lexeme));
+            advance();
+
+            consume(detail::TokenType::Colon, ErrorCode::ExpectedColon);
+
+            object.push_back({.key = std::move(key), .value = parseValue()});
+
+            if (currentToken.type == detail::TokenType::RightBrace)
+                break;
+            consume(detail::TokenType::Comma, ErrorCode::ExpectedCommaOrBrace);
+        }
+    }
+
+    consume(detail::TokenType::RightBrace, ErrorCode::ExpectedObjectEnd);
+    object.shrink_to_fit();
+    return {std::move(object)};
+}
+CompactValue CompactParser::parseArray()
+{
+    consume(detail::TokenType::LeftBracket, ErrorCode::ExpectedArrayStart);
+    CompactArray array;
+
+    if (currentToken.type != detail::TokenType::RightBracket) {
+        while (true) {
+            array.push_back(parseValue());
+            if (currentToken.type == detail::TokenType::RightBracket)
+                break;
+            consume(detail::TokenType::Comma,
+                    ErrorCode::ExpectedCommaOrBracket);
+        }
+    }
+
+    consume(detail::TokenType::RightBracket, ErrorCode::ExpectedArrayEnd);
+    array.shrink_to_fit();
+    return {std::move(array)};
+}
+CompactValue CompactParser::parse(std::string_view source)
+{
+    CompactParser parser(source);
+    CompactValue value = parser.parseValue();
+    if (parser.currentToken.type != detail::TokenType::EndOfFile) {
+        parser.fail(ErrorCode::TrailingContent);
+    }
+    return value;
+}
+void serialise(const CompactValue& val, std::ostream& os)
+{
+    val.visit([&](const auto& arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, std::nullptr_t>) {
+            os << "null";
+        } else if constexpr (std::is_same_v<T, bool>) {
+            os << (arg ? "true" : "false");
+        } else if constexpr (std::is_same_v<T, double>) {
+            detail::writeShortestNumber(arg, os);
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            detail::writeEscapedString(arg, os);
+        } else if constexpr (std::is_same_v<T, CompactArray>) {
+            os << '[';
+            for (size_t i = 0; i < arg.size(); ++i) {
+                if (i > 0) {
+                    os << ',';
+                }
+                serialise(arg[i], os);
+            }
+            os << ']';
+        } else if constexpr (std::is_same_v<T, CompactObject>) {
+            os << '{';
+            for (size_t i = 0; i < arg.size(); ++i) {
+                if (i > 0) {
+                    os << ',';
+                }
+                detail::writeEscapedString(arg[i].key.asString(), os);
+                os << ':';
+                serialise(arg[i].value, os);
+            }
+            os << '}';
+        }
+    });
+}
+std::ostream& operator<<(std::ostream& os, const CompactValue& val)
+{
+    serialise(val, os);
+    return os;
+}
+} // namespace json
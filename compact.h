@@ -0,0 +1,371 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace json
+{
+
+class CompactValue;
+struct CompactMember;
+
+// a vector that keeps up to InlineCount elements inside itself and only goes
+// to the heap past that. most arrays and objects are tiny, and this way they
+// take one allocation (the container itself) instead of two.
+template <typename T, size_t InlineCount>
+class SmallVector
+{
+    T* elements;
+    uint32_t count = 0;
+    uint32_t capacityCount = InlineCount;
+    alignas(T) std::byte inlineStorage[InlineCount * sizeof(T)];
+
+    [[nodiscard]] T* inlineElements()
+    {
+        return std::launder(reinterpret_cast<T*>(inlineStorage));
+    }
+    [[nodiscard]] bool isInline() const
+    {
+        return elements == reinterpret_cast<const T*>(inlineStorage);
+    }
+    void reallocate(size_t newCapacity);
+    void takeFrom(SmallVector&& other) noexcept;
+
+   public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() : elements(inlineElements()) {}
+    SmallVector(std::initializer_list<T> list);
+    template <typename Iter>
+    SmallVector(Iter first, Iter last);
+    SmallVector(const SmallVector& other);
+    SmallVector(SmallVector&& other) noexcept;
+    SmallVector& operator=(const SmallVector& other);
+    SmallVector& operator=(SmallVector&& other) noexcept;
+    ~SmallVector();
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] size_t capacity() const { return capacityCount; }
+
+    T* data() { return elements; }
+    [[nodiscard]] const T* data() const { return elements; }
+    iterator begin() { return elements; }
+    iterator end() { return elements + count; }
+    [[nodiscard]] const_iterator begin() const { return elements; }
+    [[nodiscard]] const_iterator end() const { return elements + count; }
+
+    T& operator[](size_t i) { return elements[i]; }
+    const T& operator[](size_t i) const { return elements[i]; }
+    T& front() { return elements[0]; }
+    T& back() { return elements[count - 1]; }
+    [[nodiscard]] const T& front() const { return elements[0]; }
+    [[nodiscard]] const T& back() const { return elements[count - 1]; }
+
+    void reserve(size_t newCapacity);
+    // moves spilled elements into a heap block of exactly the right size
+    void shrink_to_fit();
+    void clear();
+
+    void push_back(const T& value);
+    void push_back(T&& value);
+    template <typename... Args>
+    T& emplace_back(Args&&... args);
+    void pop_back();
+    iterator erase(const_iterator pos);
+};
+
+using CompactArray = SmallVector<CompactValue, 4>;
+// members are kept in insertion order
+using CompactObject = SmallVector<CompactMember, 4>;
+
+// a JSON value in 16 bytes (a JsonValue needs several times that).
+//
+// numbers and bools are stored inline. strings of up to 14 bytes are stored
+// inline too, longer ones and all containers live on the heap behind a
+// pointer. the last byte is the tag saying which of those we've got.
+//
+// empty arrays and objects are a null pointer, so they allocate nothing.
+// small ones keep their elements in the one allocation with the container
+// (see SmallVector).
+class CompactValue
+{
+   public:
+    enum class Type : uint8_t { Null, Bool, Number, String, Array, Object };
+
+    static constexpr size_t maxInlineString = 14;
+
+   private:
+    // bytes [0, 8) hold the double/bool/pointer payload, or [0, 14) the
+    // characters of an inline string. byte 14 is the inline string's length
+    // and byte 15 the tag.
+    alignas(8) std::byte bytes[16];
+
+    // high bit of the tag byte: string lives on the heap
+    static constexpr uint8_t heapStringFlag = 0x80;
+
+    [[nodiscard]] uint8_t tag() const;
+    void setTag(Type type, bool heapString = false);
+    [[nodiscard]] bool hasHeapString() const;
+
+    template <typename T>
+    [[nodiscard]] T payload() const;
+    template <typename T>
+    void setPayload(T value);
+
+    void setString(std::string_view s);
+    template <typename Container>
+    void setContainer(Type type, Container&& container);
+    void copyFrom(const CompactValue& other);
+    void destroy();
+
+   public:
+    // Constructors for each JSON type
+    CompactValue(std::nullptr_t = nullptr);
+    CompactValue(bool b);
+    CompactValue(double d);
+    CompactValue(int i);
+    CompactValue(std::string_view s);
+    CompactValue(const std::string& s);
+    CompactValue(const char* s);
+    CompactValue(CompactArray a);
+    CompactValue(CompactObject o);
+
+    CompactValue(const CompactValue& other);
+    CompactValue(CompactValue&& other) noexcept;
+    CompactValue& operator=(const CompactValue& other);
+    CompactValue& operator=(CompactValue&& other) noexcept;
+    ~CompactValue();
+
+    [[nodiscard]] Type type() const;
+
+    // Helper functions to check the contained type
+    [[nodiscard]] bool isNull() const;
+    [[nodiscard]] bool isBool() const;
+    [[nodiscard]] bool isNumber() const;
+    [[nodiscard]] bool isString() const;
+    [[nodiscard]] bool isArray() const;
+    [[nodiscard]] bool isObject() const;
+
+    // type-safe accessors. !!throws std::bad_variant_access on type mismatch!!
+    // strings are read-only, assign a new value to change one.
+    [[nodiscard]] bool asBool() const;
+    [[nodiscard]] double asNumber() const;
+    [[nodiscard]] std::string_view asString() const;
+    CompactArray& asArray();
+    CompactObject& asObject();
+    [[nodiscard]] const CompactArray& asArray() const;
+    [[nodiscard]] const CompactObject& asObject() const;
+
+    // member lookup on objects, nullptr if this isn't an object or the key
+    // is missing
+    [[nodiscard]] const CompactValue* find(std::string_view key) const;
+    CompactValue* find(std::string_view key);
+
+    // calls f with whichever of std::nullptr_t, bool, double,
+    // std::string_view, const CompactArray& or const CompactObject& is held
+    template <typename F>
+    decltype(auto) visit(F&& f) const;
+
+    // conversions to and from the regular JsonValue
+    static CompactValue from(const JsonValue& value);
+    [[nodiscard]] JsonValue toJsonValue() const;
+};
+
+static_assert(sizeof(CompactValue) == 16);
+
+struct CompactMember
+{
+    CompactValue key; // always a string
+    CompactValue value;
+};
+
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::reallocate(size_t newCapacity)
+{
+    T* target = newCapacity <= InlineCount
+                  ? inlineElements()
+                  : static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+    if (target != elements) {
+        std::uninitialized_move(elements, elements + count, target);
+        std::destroy(elements, elements + count);
+        if (!isInline()) {
+            ::operator delete(elements);
+        }
+        elements = target;
+    }
+    capacityCount = static_cast<uint32_t>(std::max(newCapacity, InlineCount));
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::takeFrom(SmallVector&& other) noexcept
+{
+    if (other.isInline()) {
+        elements = inlineElements();
+        std::uninitialized_move(other.begin(), other.end(), elements);
+        std::destroy(other.begin(), other.end());
+    } else {
+        elements = std::exchange(other.elements, other.inlineElements());
+    }
+    count = std::exchange(other.count, 0);
+    capacityCount = std::exchange(other.capacityCount, InlineCount);
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>::SmallVector(std::initializer_list<T> list)
+  : SmallVector(list.begin(), list.end())
+{
+}
+template <typename T, size_t InlineCount>
+template <typename Iter>
+SmallVector<T, InlineCount>::SmallVector(Iter first, Iter last) : SmallVector()
+{
+    reserve(std::distance(first, last));
+    for (; first != last; ++first) {
+        emplace_back(*first);
+    }
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>::SmallVector(const SmallVector& other)
+  : SmallVector(other.begin(), other.end())
+{
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>::SmallVector(SmallVector&& other) noexcept
+{
+    takeFrom(std::move(other));
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>&
+SmallVector<T, InlineCount>::operator=(const SmallVector& other)
+{
+    if (this != &other) {
+        SmallVector copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>&
+SmallVector<T, InlineCount>::operator=(SmallVector&& other) noexcept
+{
+    if (this != &other) {
+        clear();
+        if (!isInline()) {
+            ::operator delete(elements);
+        }
+        takeFrom(std::move(other));
+    }
+    return *this;
+}
+template <typename T, size_t InlineCount>
+SmallVector<T, InlineCount>::~SmallVector()
+{
+    clear();
+    if (!isInline()) {
+        ::operator delete(elements);
+    }
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::reserve(size_t newCapacity)
+{
+    if (newCapacity > capacityCount) {
+        reallocate(newCapacity);
+    }
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::shrink_to_fit()
+{
+    if (!isInline() && count < capacityCount) {
+        reallocate(count);
+    }
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::clear()
+{
+    std::destroy(begin(), end());
+    count = 0;
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::push_back(const T& value)
+{
+    emplace_back(value);
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::push_back(T&& value)
+{
+    emplace_back(std::move(value));
+}
+template <typename T, size_t InlineCount>
+template <typename... Args>
+T& SmallVector<T, InlineCount>::emplace_back(Args&&... args)
+{
+    if (count == capacityCount) {
+        // args might refer to one of our own elements, so construct the new
+        // element before moving everything over
+        T value(std::forward<Args>(args)...);
+        reallocate(2 * capacityCount);
+        return *std::construct_at(elements + count++, std::move(value));
+    }
+    return *std::construct_at(elements + count++, std::forward<Args>(args)...);
+}
+template <typename T, size_t InlineCount>
+void SmallVector<T, InlineCount>::pop_back()
+{
+    std::destroy_at(elements + --count);
+}
+template <typename T, size_t InlineCount>
+typename SmallVector<T, InlineCount>::iterator
+SmallVector<T, InlineCount>::erase(const_iterator pos)
+{
+    auto* target = elements + (pos - elements);
+    std::move(target + 1, end(), target);
+    pop_back();
+    return target;
+}
+
+template <typename T>
+T CompactValue::payload() const
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+template <typename T>
+void CompactValue::setPayload(T value)
+{
+    std::memcpy(bytes, &value, sizeof(T));
+}
+template <typename F>
+decltype(auto) CompactValue::visit(F&& f) const
+{
+    switch (type()) {
+        case Type::Null: return f(nullptr);
+        case Type::Bool: return f(payload<bool>());
+        case Type::Number: return f(payload<double>());
+        case Type::String: return f(asString());
+        case Type::Array: return f(asArray());
+        case Type::Object: return f(asObject());
+    }
+    return f(nullptr); // unreachable
+}
+
+// parses straight into CompactValues, without going through JsonValue.
+// !!throws ParsingError on invalid input!!
+[[nodiscard]] CompactValue parseCompact(std::string_view source);
+
+// compact serialisation (no whitespace)
+void serialise(const CompactValue& val, std::ostream& os);
+
+std::ostream& operator<<(std::ostream& os, const CompactValue& val);
+
+} // namespace json
@@ -1 +1 @@
-clang++ -std=c++20 main.cc json.cc -I. -o main -Wall -Wextra -O3
+clang++ -std=c++20 main.cc json.cc compact.cc bind.cc template.cc path.cc columns.cc index.cc -I. -o main -Wall -Wextra -O3 -pthread
@@ -0,0 +1,185 @@
+#pragma once
+
+// internals shared between the json translation units. not part of the
+// public interface.
+
+#include "json.h"
+#include "scalars.h"
+
+namespace json
+{
+
+namespace detail
+{
+
+enum class TokenType : uint8_t {
+    LeftBrace,
+    RightBrace,
+    LeftBracket,
+    RightBracket,
+    Comma,
+    Colon,
+    String,
+    Number,
+    True,
+    False,
+    Null,
+    EndOfFile,
+    Unknown
+};
+
+struct Token
+{
+    TokenType type;
+    std::string_view lexeme;
+    size_t line;
+    size_t col;
+    // strings only: has at least one escape sequence in it
+    bool escaped = false;
+};
+
+class Lexer
+{
+    std::string_view source;
+    const char* start;
+    const char* current;
+    size_t lineNum = 1;
+    size_t colNum = 1;
+    size_t lineStart = 1;
+    size_t colStart = 1;
+    size_t commentCount = 0;
+    // source is followed by PaddedString::padding zero bytes
+    bool padded = false;
+    // treat 0x1E (RFC 7464 record separator) as whitespace
+    bool recordSeparators = false;
+    // why the last Unknown token is one
+    ErrorCode problem = ErrorCode::None;
+
+    // with Padded, reading past the end is fine (it's all zeros), so these
+    // don't check for it. loops stop at a '\0' and then check endsAt.
+    [[nodiscard]] bool isAtEnd() const;
+    [[nodiscard]] bool endsAt(char c) const;
+    template <bool Padded>
+    char advance();
+    template <bool Padded>
+    [[nodiscard]] char peek() const;
+    template <bool Padded>
+    [[nodiscard]] char peekNext() const;
+    template <bool Padded>
+    void skipWhitespaceAndComments();
+    [[nodiscard]] Token makeToken(TokenType type) const;
+    // the byte offset bytes ahead, '\0' if that's past the end
+    template <bool Padded>
+    [[nodiscard]] char peekAt(size_t offset) const;
+    [[nodiscard]] Token failToken(ErrorCode code);
+    // skips to the next byte in a string that needs a closer look
+    template <bool Padded>
+    void skipPlainStringBytes();
+    // skips what follows a backslash, false if it's not a valid escape
+    template <bool Padded>
+    bool skipEscape();
+    template <bool Padded>
+    Token stringToken();
+    template <bool Padded>
+    Token numberToken();
+    template <bool Padded>
+    Token identifierToken();
+    template <bool Padded>
+    Token lex();
+    template <bool Padded>
+    ErrorCode skipContainer();
+
+   public:
+    Lexer(std::string_view source, bool padded = false,
+          bool recordSeparators = false);
+    Token nextToken();
+    // with the opening bracket of an array or object just lexed, moves past
+    // its closing one. only looks at brackets (checking each closes the
+    // right kind), strings and comments, so it's a lot quicker than lexing
+    // it all. returns why it couldn't, if it couldn't.
+    ErrorCode skipContainer();
+    // where lexing carries on from, just past the last token (or skipped
+    // container)
+    [[nodiscard]] const char* position() const;
+
+    // number of comments skipped so far
+    [[nodiscard]] size_t comments() const;
+    // what's wrong with the last Unknown token
+    [[nodiscard]] ErrorCode error() const;
+};
+
+// a token at a time over a source, for the readers that go from the text
+// straight to something other than a JsonValue (bind.h's structs and
+// columns.h's columns). errors are thrown as ParsingErrors.
+class TokenReader
+{
+    Lexer lexer;
+    // start of the source (before any byte order mark), for error offsets
+    const char* origin;
+
+   public:
+    Token current;
+    // for unescaping keys and strings into, so they don't allocate
+    std::string scratch;
+
+    // skips a byte order mark at the start of source
+    explicit TokenReader(std::string_view source);
+
+    // !!throws ParsingError!!
+    [[noreturn]] void fail(ErrorCode code);
+    void advance();
+    // advances past the current token if it's a type.
+    // !!throws ParsingError with code if it isn't!!
+    void consume(TokenType type, ErrorCode code);
+    // the current string token's text, unescaped into scratch if it has to
+    // be
+    [[nodiscard]] std::string_view text();
+
+    // moves past the current value keeping nothing. arrays and objects are
+    // only scanned for their closing bracket.
+    // !!throws ParsingError!!
+    void skipValue();
+    // parses the current value and moves past it, in the same pass.
+    // !!throws ParsingError!!
+    JsonValue parseValue();
+};
+
+// source without the UTF-8 byte order mark at its start, if it has one
+std::string_view skipByteOrderMark(std::string_view source);
+
+// the number of direct children of every array and object in source, in the
+// order their opening brackets appear. only looks at brackets, commas,
+// strings and comments, so on invalid input the counts can be off (but the
+// parse will fail anyway).
+// counts and open (scratch space) are cleared first, so passing the same
+// ones every time reuses their memory.
+void countChildren(std::string_view source, std::vector<uint32_t>& counts,
+                   std::vector<std::pair<size_t, bool>>& open);
+// how many arrays and objects open in source, counted the same way, so a
+// parser skipping source can skip its entries in countChildren's counts
+size_t countContainers(std::string_view source);
+
+// unescapes a string token's lexeme (quotes included) into result,
+// replacing what was there. \u escapes are decoded to UTF-8, surrogate pairs
+// included. a surrogate without its other half becomes U+FFFD.
+void unescapeString(std::string_view lexeme, std::string& result);
+
+// decodes the \u escape whose hex digits start at view[pos], appending it to
+// result. returns where the escape (or the pair of them) ends.
+size_t appendUnicodeEscape(std::string_view view, size_t pos,
+                           std::string& result);
+
+// unescapes a string token's lexeme (quotes included)
+std::string unescapeString(std::string_view lexeme);
+
+// writes str quoted and with everything JSON requires escaped
+void writeEscapedString(std::string_view str, std::ostream& os);
+void writeEscapedString(std::string_view str, std::string& out);
+
+// writes num with the fewest digits that still read back exactly
+void writeShortestNumber(double num, std::ostream& os);
+void writeShortestNumber(double num, std::string& out);
+
+} // namespace detail
+
+} // namespace json
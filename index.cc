@@ -0,0 +1,261 @@
+#include "index.h"
+
+#include <algorithm>
+#include <bit>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace json
+{
+
+namespace
+{
+
+// makes every bit of h depend on all of them, so the top bits picking a
+// key's first slot are as good as any
+uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// work(part) for each part, on a thread each unless there's only one
+template <typename Work>
+void runParts(unsigned parts, const Work& work)
+{
+    if (parts == 1) {
+        work(0U);
+        return;
+    }
+    std::vector<std::future<void>> futures;
+    futures.reserve(parts);
+    for (unsigned part = 0; part < parts; ++part) {
+        futures.push_back(
+          std::async(std::launch::async, [&work, part]() { work(part); }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+} // namespace
+
+bool Index::Key::operator==(const Key& other) const
+{
+    return kind == other.kind && number == other.number &&
+           string == other.string;
+}
+
+std::optional<Index::Key> Index::keyOf(const JsonValue& value)
+{
+    const auto& held = value.value;
+    if (const auto* string = std::get_if<std::string>(&held)) {
+        return Key{.kind = Key::Kind::String, .string = *string};
+    }
+    if (const auto* interned = std::get_if<InternedString>(&held)) {
+        return Key{.kind = Key::Kind::String, .string = **interned};
+    }
+    if (const auto* number = std::get_if<double>(&held)) {
+        return Key{.kind = Key::Kind::Number, .number = *number};
+    }
+    if (const auto* boolean = std::get_if<bool>(&held)) {
+        return Key{.kind = Key::Kind::Bool, .number = *boolean ? 1.0 : 0.0};
+    }
+    if (std::holds_alternative<std::nullptr_t>(held)) {
+        return Key{.kind = Key::Kind::Null};
+    }
+    return std::nullopt;
+}
+std::optional<Index::Key> Index::keyAt(size_t pos) const
+{
+    // the array can have shrunk through a reference taken before it was
+    // indexed, which version() doesn't notice
+    if (numbers != nullptr) {
+        if (pos >= numbers->size() || !keyPath.segments().empty()) {
+            return std::nullopt;
+        }
+        return Key{.kind = Key::Kind::Number, .number = (*numbers)[pos]};
+    }
+    if (pos >= records->size()) {
+        return std::nullopt;
+    }
+    const JsonValue* value = (*records)[pos].find(keyPath);
+    return value ? keyOf(*value) : std::nullopt;
+}
+uint64_t Index::hashKey(const Key& key)
+{
+    switch (key.kind) {
+        case Key::Kind::String: return mix(JsonObject::hashKey(key.string));
+        case Key::Kind::Number:
+            // -0 == 0, so they have to hash the same
+            return mix(std::bit_cast<uint64_t>(key.number == 0 ? 0.0
+                                                               : key.number));
+        default:
+            return mix(static_cast<uint64_t>(key.kind) * 2 +
+                       static_cast<uint64_t>(key.number));
+    }
+}
+
+// the elements are split into as many chunks as there are parts, and each
+// chunk's keys are found and hashed on a thread of its own. then each part
+// of the table gets filled in on a thread, from the keys whose first slot is
+// in it. a key that would have to go past the end of its part waits until
+// they're all done and goes in afterwards, wrapping around if it has to.
+//
+// within a part keys go in in the order of their elements, so where keys
+// repeat it's the first element's that's kept.
+void Index::build()
+{
+    if (!array->isArray()) {
+        detail::raise(std::invalid_argument("Index: not an array"));
+    }
+    const auto& held = array->materialize().value;
+    records = std::get_if<JsonArray>(&held);
+    const auto* packed = std::get_if<detail::PackedArray>(&held);
+    numbers = packed ? &packed->numbers : nullptr;
+    const size_t count = records ? records->size() : numbers->size();
+    if (count >= UINT32_MAX) {
+        detail::raise(std::length_error("Index: too many elements"));
+    }
+    builtVersion = array->version();
+
+    const size_t capacity = std::max<size_t>(16, std::bit_ceil(count * 2));
+    const unsigned capacityBits = std::countr_zero(capacity);
+    shift = 64 - capacityBits;
+    slots.assign(capacity, Slot{.hash = 0, .position = empty});
+    // each element's key hash (for those that have a key)
+    std::vector<uint64_t> hashes(count);
+
+    unsigned parts = 1;
+    if (count >= parallelThreshold) {
+        parts = threads == 0 ? std::thread::hardware_concurrency() : threads;
+        // so the table splits evenly
+        parts = std::bit_floor(std::clamp(parts, 1U, 256U));
+    }
+    const unsigned partBits = std::countr_zero(parts);
+    const size_t partSize = capacity >> partBits;
+
+    // byPart[chunk][part] lists the chunk's elements whose key goes in part
+    std::vector<std::vector<std::vector<uint32_t>>> byPart(
+      parts, std::vector<std::vector<uint32_t>>(parts));
+    runParts(parts, [&](unsigned chunk) {
+        const size_t first = count * chunk / parts;
+        const size_t last = count * (chunk + 1) / parts;
+        for (size_t pos = first; pos < last; ++pos) {
+            auto key = keyAt(pos);
+            if (!key) {
+                continue;
+            }
+            hashes[pos] = hashKey(*key);
+            byPart[chunk][(hashes[pos] >> shift) >> (capacityBits - partBits)]
+              .push_back(static_cast<uint32_t>(pos));
+        }
+    });
+
+    // puts pos in the first free slot from its hash's on, unless its key is
+    // already there. with an end, gives up (returning false) rather than
+    // going on to end or wrapping around.
+    auto insert = [&](uint32_t pos, std::optional<size_t> end,
+                      size_t& inserted) {
+        const uint64_t hash = hashes[pos];
+        const Key key = *keyAt(pos);
+        for (size_t i = hash >> shift; !end || i < *end; ++i) {
+            Slot& slot = slots[i & (capacity - 1)];
+            if (slot.position == empty) {
+                slot = Slot{.hash = static_cast<uint32_t>(hash),
+                            .position = pos};
+                inserted++;
+                return true;
+            }
+            if (slot.hash == static_cast<uint32_t>(hash) &&
+                *keyAt(slot.position) == key)
+            {
+                slot.position = std::min(slot.position, pos);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<std::vector<uint32_t>> overflow(parts);
+    std::vector<size_t> inserted(parts);
+    runParts(parts, [&](unsigned part) {
+        const size_t end = partSize * (part + 1);
+        for (const auto& chunk : byPart) {
+            for (uint32_t pos : chunk[part]) {
+                if (!insert(pos, end, inserted[part])) {
+                    overflow[part].push_back(pos);
+                }
+            }
+        }
+    });
+
+    keyCount = 0;
+    for (unsigned part = 0; part < parts; ++part) {
+        for (uint32_t pos : overflow[part]) {
+            insert(pos, std::nullopt, inserted[part]);
+        }
+        keyCount += inserted[part];
+    }
+}
+
+Index::Index(const JsonValue& array, std::string_view keyPath,
+             unsigned threads)
+  : array(&array), keyPath(keyPath), threads(threads)
+{
+    build();
+}
+
+bool Index::stale() const
+{
+    return array->version() != builtVersion;
+}
+void Index::rebuild()
+{
+    build();
+}
+
+std::optional<size_t> Index::position(const JsonValue& key) const
+{
+    if (stale()) {
+        detail::raise(
+          std::logic_error("Index: the array was modified since it was built"));
+    }
+    auto wanted = keyOf(key.materialize());
+    if (!wanted) {
+        return std::nullopt;
+    }
+    const uint64_t hash = hashKey(*wanted);
+    for (size_t i = hash >> shift;; i = (i + 1) & (slots.size() - 1)) {
+        const Slot& slot = slots[i];
+        if (slot.position == empty) {
+            return std::nullopt;
+        }
+        if (slot.hash == static_cast<uint32_t>(hash) &&
+            keyAt(slot.position) == wanted)
+        {
+            return slot.position;
+        }
+    }
+}
+const JsonValue* Index::find(const JsonValue& key) const
+{
+    auto pos = position(key);
+    if (!pos) {
+        return nullptr;
+    }
+    // a packed array's elements come from the copy its const asArray() makes
+    return records ? &(*records)[*pos] : &array->asArray()[*pos];
+}
+
+size_t Index::size() const
+{
+    return keyCount;
+}
+
+} // namespace json
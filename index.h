@@ -0,0 +1,112 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// a hash index over an array of records, for looking records up by a key
+// (an id, usually) instead of scanning the array for it:
+//
+//   json::Index byId(config.asObject().at("users"), "/id");
+//   const json::JsonValue* user = byId.find("u-1234");
+
+namespace json
+{
+
+// an open addressing table from key values to the positions of the elements
+// holding them. keys are whatever's at the pointer in each element, and can
+// be strings, numbers, booleans or null: the same number written 1 or 1.0 is
+// the same key, but the number 1 and the string "1" aren't. elements that
+// don't have one (or have an array or object there) aren't in the index, and
+// where several elements share a key the first one is.
+//
+// the index holds on to the array without copying anything, so the array
+// must stay where it is until the index goes. it remembers the array's
+// version() and refuses lookups once that changes (a DocumentParser parsing
+// the next document into it counts), rebuild() brings it back up to date.
+// it keeps only positions and reads keys out of the elements again when it
+// compares them, so an array modified through a reference taken earlier
+// (which version() can't notice) gives wrong answers at worst, never
+// dangling ones.
+class Index
+{
+    // a key read out of its JsonValue, bools as the numbers 0 and 1
+    struct Key
+    {
+        enum class Kind : uint8_t { Null, Bool, Number, String };
+        Kind kind;
+        double number = 0;
+        std::string_view string = {};
+
+        bool operator==(const Key& other) const;
+    };
+    // only positions are kept, keys are read from the elements again when
+    // they're compared
+    struct Slot
+    {
+        // the low bits of the key's hash (the top ones pick its first slot)
+        uint32_t hash;
+        // Index::empty if nothing is in the slot
+        uint32_t position;
+    };
+    static constexpr uint32_t empty = UINT32_MAX;
+
+    const JsonValue* array;
+    // what the array holds as of the last build, one of them is nullptr
+    const JsonArray* records = nullptr;
+    const NumberArray* numbers = nullptr;
+    uint32_t builtVersion = 0;
+    Pointer keyPath;
+    unsigned threads;
+
+    // a power of two of them, at most half used. a key's first slot comes
+    // from the top bits of its hash, so the table splits into contiguous
+    // ranges by hash prefix that threads can fill separately.
+    std::vector<Slot> slots;
+    unsigned shift = 0;
+    size_t keyCount = 0;
+
+    // nullopt for arrays and objects
+    static std::optional<Key> keyOf(const JsonValue& value);
+    static uint64_t hashKey(const Key& key);
+    // the key of the element at pos. in a packed array the element is its
+    // own key, if keyPath is empty.
+    std::optional<Key> keyAt(size_t pos) const;
+    void build();
+
+   public:
+    // arrays of at least this many elements are indexed on several threads
+    static constexpr size_t parallelThreshold = 32768;
+
+    // threads == 0 means use every core.
+    // !!throws std::invalid_argument if array isn't an array or keyPath isn't
+    // a valid JSON Pointer, std::length_error if it has 2^32 - 1 elements or
+    // more, ParsingError if a raw element isn't valid JSON!!
+    Index(const JsonValue& array, std::string_view keyPath,
+          unsigned threads = 0);
+
+    // whether the array has (possibly) been modified since the index was
+    // built
+    [[nodiscard]] bool stale() const;
+    // builds the index again from what's in the array now.
+    // !!throws like the constructor does!!
+    void rebuild();
+
+    // position in the array of the first element with this key.
+    // !!throws std::logic_error if the index is stale!!
+    [[nodiscard]] std::optional<size_t> position(const JsonValue& key) const;
+    // the same element itself, nullptr if there isn't one. for a packed
+    // array (see JsonValue::isNumberArray()) that's an element of the copy
+    // the const asArray() makes, position() doesn't need one.
+    // !!throws std::logic_error if the index is stale!!
+    [[nodiscard]] const JsonValue* find(const JsonValue& key) const;
+
+    // number of distinct keys
+    [[nodiscard]] size_t size() const;
+};
+
+} // namespace json
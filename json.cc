@@ -1,512 +1,2335 @@
 #include "json.h"
+#include "detail.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 namespace json
 {
 
-namespace detail
+class Parser
 {
+    detail::Lexer lexer;
+    detail::Token currentToken;
+    detail::Token previousToken;
+    ParseOptions options;
 
-enum class TokenType : uint8_t {
-    LeftBrace,
-    RightBrace,
-    LeftBracket,
-    RightBracket,
-    Comma,
-    Colon,
-    String,
-    Number,
-    True,
-    False,
-    Null,
-    EndOfFile,
-    Unknown
-};
+    // Document mode: where every value came from. a value's span goes at
+    // its version() minus firstStamp, for up to stampCount of them. a value
+    // can still be parsed over until its parent is done, so its span waits
+    // in pendingSpans (with its position in the parent) until then.
+    // lastSpan is the one parseValue found last.
+    std::vector<std::string_view>* spans = nullptr;
+    uint32_t firstStamp = 0;
+    uint32_t stampCount = 0;
+    std::vector<std::pair<size_t, std::string_view>> pendingSpans;
+    std::string_view lastSpan;
+    // DocumentStream: skip RFC 7464 record separators like whitespace
+    bool recordSeparators = false;
+    // comments the lexer had skipped before it lexed currentToken
+    size_t commentsBeforeCurrent = 0;
 
-struct Token
-{
-    TokenType type;
-    std::string_view lexeme;
-    size_t line;
-    size_t col;
-};
+    // how many arrays/objects we're currently inside of
+    size_t depth = 0;
+    // the keys of the last object parsed at each depth. objects at the same
+    // depth very often have the same keys (think arrays of records), so
+    // parseObject expects those keys and shares them when they match.
+    std::vector<detail::SharedKeys> shapeHints;
 
-class Lexer
-{
-    std::string_view source;
-    const char* start;
-    const char* current;
-    size_t lineNum = 1;
-    size_t colNum = 1;
-    size_t lineStart = 1;
-    size_t colStart = 1;
-
-    [[nodiscard]] bool isAtEnd() const;
-    char advance();
-    [[nodiscard]] char peek() const;
-    [[nodiscard]] char peekNext() const;
-    void skipWhitespaceAndComments();
-    [[nodiscard]] Token makeToken(TokenType type) const;
-    Token stringToken();
-    Token numberToken();
-    Token identifierToken();
+    // ParseOptions::precount: children of each container in the order they
+    // open, and which container comes next
+    std::vector<uint32_t> childCounts;
+    size_t nextContainer = 0;
+    std::vector<std::pair<size_t, bool>> openContainers;
 
-   public:
-    Lexer(std::string_view source);
-    Token nextToken();
-};
-} // namespace detail
+    // for unescaping strings before looking them up in the pool
+    std::string scratch;
+    // checkContainer's stack, the closing bracket each open container wants
+    std::vector<detail::TokenType> rawClosers;
 
-class Parser
-{
-    detail::Lexer lexer;
-    detail::Token currentToken;
-    detail::Token previousToken;
+    // ParseOptions::rawPaths: the node for the value about to be parsed,
+    // nullptr once we're off the paths
+    const Projection::Node* rawCursor = nullptr;
+
+    // the first error. once there is one every parse function just returns
+    // whatever it has, and the result is thrown away.
+    ParseError error;
+    // start of the source (before any byte order mark), for error offsets
+    const char* origin = nullptr;
 
-    Parser(std::string_view source);
+    explicit Parser(const ParseOptions& options);
+    Parser(std::string_view source, bool padded, const ParseOptions& options);
+    // (re)starts parsing at the beginning of source. padded means it's
+    // followed by PaddedString::padding zero bytes.
+    void start(std::string_view source, bool padded = false);
 
+    [[nodiscard]] bool failed() const;
+    void fail(ErrorCode code);
     void advance();
-    void consume(detail::TokenType type, const std::string& message);
-    JsonValue parseValue();
-    JsonValue parseString();
-    JsonValue parseNumber();
-    JsonObject parseObject();
-    JsonArray parseArray();
+    // advances past the current token if it's a type, fails with code if not
+    bool consume(detail::TokenType type, ErrorCode code);
+    // these all parse into target. whatever target already holds gets
+    // written over, reusing its memory where the old and new values are
+    // alike (see DocumentParser)
+    // the whole source has to be the one value, unless prefix
+    void parseRoot(JsonValue& root, bool prefix = false);
+    // fails if there's more than whitespace and comments left
+    void expectEnd();
+    // bytes from the start of the source to the end of the last value
+    [[nodiscard]] size_t consumed() const;
+    void parseValue(JsonValue& target);
+    void parseValueContents(JsonValue& target);
+    void parseString(JsonValue& target);
+    void parseNumber(JsonValue& target);
+    void parseObject(JsonValue& target);
+    void parseArray(JsonValue& target);
+    // ParseOptions::rawDepth and rawPaths
+    [[nodiscard]] bool keepRaw() const;
+    void parseRaw(JsonValue& target);
+    // lexes the array or object at currentToken and checks it's valid
+    // without building anything, failing where parsing it would have.
+    // stops on its closing bracket.
+    void checkContainer();
+    // the key to store in a new object for text (a key's unescaped text).
+    // unescaped is where text is if it's been unescaped, and gets moved from.
+    detail::KeyName keyName(std::string_view text, std::string& unescaped);
+    size_t expectedChildren();
+    // the next of elements to parse into: an old one while there are any,
+    // then new ones
+    static JsonValue& nextElement(std::vector<JsonValue>& elements,
+                                  size_t& used);
+
+    // parse(source, projection): parses what's on node's paths into target,
+    // false if none of them were in there
+    bool parseProjected(JsonValue& target, const Projection::Node& node);
+    // moves past the current value without building it
+    void skipValue();
+
+    static JsonObject objectWithKeys(const detail::SharedKeys& keys,
+                                     size_t count,
+                                     std::vector<JsonValue>& values);
+
+    // Document mode: the span parseValue just found goes on hold as the
+    // element at pos of the container being parsed
+    void holdSpan(size_t pos);
+    // Document mode: records the spans held from first on, now that the
+    // container holding those elements is done (and won't move them again)
+    void recordSpans(size_t first, std::vector<JsonValue>& elements);
+    // Document mode: records value's span and gives it the version that
+    // finds it
+    void recordSpan(JsonValue& value, std::string_view text);
+
+    friend class Document;
+    friend class detail::TokenReader;
+    friend class DocumentParser;
+    friend class DocumentStream;
 
    public:
-    static JsonValue parse(std::string_view source);
+    static JsonValue parse(std::string_view source, bool padded,
+                           const ParseOptions& options);
+    static Result<JsonValue> tryParse(std::string_view source, bool padded,
+                                      const ParseOptions& options);
+    static Result<PrefixResult> tryParsePrefix(std::string_view source,
+                                               const ParseOptions& options);
+    static Result<JsonValue> tryParse(std::string_view source,
+                                      const Projection& projection);
 };
 
 JsonValue parse(std::string_view source)
 {
-    return Parser::parse(source);
+    return Parser::parse(source, false, {});
 }
-
-ParsingError::ParsingError(const std::string& message, size_t line, size_t col)
-  : std::runtime_error(message + " (at line " + std::to_string(line) +
-                       ", col " + std::to_string(col) + ")"),
-    lineNum(line), colNum(col)
+JsonValue parse(std::string_view source, const ParseOptions& options)
 {
+    return Parser::parse(source, false, options);
 }
-size_t ParsingError::line() const
+JsonValue parse(PaddedView source, const ParseOptions& options)
 {
-    return lineNum;
+    return Parser::parse(source.view(), true, options);
 }
-size_t ParsingError::col() const
+Result<JsonValue> tryParse(std::string_view source)
 {
-    return colNum;
+    return Parser::tryParse(source, false, {});
 }
-JsonValue::JsonValue(std::nullptr_t) : value(nullptr)
+Result<JsonValue> tryParse(std::string_view source, const ParseOptions& options)
 {
+    return Parser::tryParse(source, false, options);
 }
-JsonValue::JsonValue(bool b) : value(b)
+Result<JsonValue> tryParse(PaddedView source, const ParseOptions& options)
 {
+    return Parser::tryParse(source.view(), true, options);
 }
-JsonValue::JsonValue(double d) : value(d)
+JsonValue parse(std::string_view source, const Projection& projection)
 {
+    return Parser::tryParse(source, projection).value();
 }
-JsonValue::JsonValue(int i) : value(static_cast<double>(i))
+Result<JsonValue> tryParse(std::string_view source,
+                           const Projection& projection)
 {
+    return Parser::tryParse(source, projection);
 }
-JsonValue::JsonValue(const std::string& s) : value(s)
+PrefixResult parsePrefix(std::string_view source, const ParseOptions& options)
 {
+    return tryParsePrefix(source, options).value();
 }
-JsonValue::JsonValue(std::string&& s) : value(std::move(s))
+Result<PrefixResult> tryParsePrefix(std::string_view source,
+                                    const ParseOptions& options)
 {
+    return Parser::tryParsePrefix(source, options);
 }
-JsonValue::JsonValue(const char* s) : value(std::string(s))
+
+PaddedString::PaddedString(std::string_view text)
+  : buffer(std::make_unique<char[]>(text.length() + padding)),
+    length(text.length())
 {
+    // make_unique value-initialises, so the padding is zeros already
+    std::memcpy(buffer.get(), text.data(), text.length());
 }
-JsonValue::JsonValue(const JsonArray& a) : value(a)
+PaddedString::PaddedString(const PaddedString& other)
+  : PaddedString(other.view())
 {
 }
-JsonValue::JsonValue(JsonArray&& a) : value(std::move(a))
+PaddedString& PaddedString::operator=(const PaddedString& other)
 {
+    if (this != &other) {
+        *this = PaddedString(other.view());
+    }
+    return *this;
 }
-JsonValue::JsonValue(const JsonObject& o) : value(o)
+std::string_view PaddedString::view() const
 {
+    return {buffer.get(), length};
 }
-JsonValue::JsonValue(JsonObject&& o) : value(std::move(o))
+size_t PaddedString::size() const
 {
+    return length;
 }
-bool JsonValue::isNull() const
+PaddedString::operator PaddedView() const
 {
-    return std::holds_alternative<std::nullptr_t>(value);
+    return PaddedView(view());
 }
-bool JsonValue::isBool() const
+PaddedView::PaddedView(std::string_view text) : text(text)
 {
-    return std::holds_alternative<bool>(value);
 }
-bool JsonValue::isNumber() const
+PaddedView::PaddedView(char* buffer, size_t length, size_t capacity)
+  : text(buffer, length)
 {
-    return std::holds_alternative<double>(value);
+    if (capacity < length + PaddedString::padding) {
+        detail::raise(std::invalid_argument(
+          "PaddedView: buffer has no room for the padding"));
+    }
+    std::memset(buffer + length, 0, PaddedString::padding);
 }
-bool JsonValue::isString() const
+std::string_view PaddedView::view() const
 {
-    return std::holds_alternative<std::string>(value);
+    return text;
 }
-bool JsonValue::isArray() const
+
+Pointer::Pointer(std::string_view path)
 {
-    return std::holds_alternative<JsonArray>(value);
+    if (path.empty()) {
+        return; // the whole document
+    }
+    if (path.front() != '/') {
+        detail::raise(
+          std::invalid_argument("JSON Pointer must start with '/'"));
+    }
+
+    while (!path.empty()) {
+        path.remove_prefix(1); // the '/'
+        size_t end = std::min(path.find('/'), path.length());
+
+        Segment segment;
+        for (size_t i = 0; i < end; ++i) {
+            if (path[i] != '~') {
+                segment.key += path[i];
+            } else if (i + 1 < end && path[i + 1] == '0') {
+                segment.key += '~';
+                i++;
+            } else if (i + 1 < end && path[i + 1] == '1') {
+                segment.key += '/';
+                i++;
+            } else {
+                detail::raise(std::invalid_argument(
+                  "'~' in a JSON Pointer must be followed by '0' or '1'"));
+            }
+        }
+        segment.hash = JsonObject::hashKey(segment.key);
+
+        // array indices are 0 or digits without a leading zero
+        const auto& key = segment.key;
+        if (!key.empty() && (key == "0" || key.front() != '0')) {
+            size_t index = 0;
+            auto [ptr, ec] =
+              std::from_chars(key.data(), key.data() + key.length(), index);
+            if (ec == std::errc() && ptr == key.data() + key.length()) {
+                segment.index = index;
+            }
+        }
+
+        segmentList.push_back(std::move(segment));
+        path.remove_prefix(end);
+    }
 }
-bool JsonValue::isObject() const
+const std::vector<Pointer::Segment>& Pointer::segments() const
 {
-    return std::holds_alternative<JsonObject>(value);
+    return segmentList;
 }
-bool& JsonValue::asBool()
+struct Projection::Node
 {
-    return std::get<bool>(value);
+    // keep everything from here down
+    bool whole = false;
+    std::vector<std::pair<Pointer::Segment, Node>> children;
+    // the * child, if there is one (at most one element)
+    std::vector<Node> any;
+
+    // the node for an object member or an array element, nullptr if it's
+    // not on any path
+    [[nodiscard]] const Node* member(std::string_view key) const
+    {
+        for (const auto& [segment, child] : children) {
+            if (segment.key == key) {
+                return &child;
+            }
+        }
+        return any.empty() ? nullptr : &any.front();
+    }
+    [[nodiscard]] const Node* element(size_t index) const
+    {
+        for (const auto& [segment, child] : children) {
+            if (segment.index == index) {
+                return &child;
+            }
+        }
+        return any.empty() ? nullptr : &any.front();
+    }
+
+    void add(const std::vector<Pointer::Segment>& path, size_t from)
+    {
+        if (whole) {
+            return;
+        }
+        if (from == path.size()) {
+            whole = true;
+            children.clear();
+            any.clear();
+            return;
+        }
+        const Pointer::Segment& segment = path[from];
+        if (segment.key == "*") {
+            if (any.empty()) {
+                any.emplace_back();
+            }
+            any.front().add(path, from + 1);
+            // what's under * is under every named child too
+            for (auto& [named, child] : children) {
+                child.add(path, from + 1);
+            }
+            return;
+        }
+        for (auto& [named, child] : children) {
+            if (named.key == segment.key) {
+                child.add(path, from + 1);
+                return;
+            }
+        }
+        // a new named child starts out with everything under *
+        Node child = any.empty() ? Node() : any.front();
+        child.add(path, from + 1);
+        children.emplace_back(segment, std::move(child));
+    }
+};
+Projection::Projection(std::initializer_list<std::string_view> paths)
+{
+    auto tree = std::make_shared<Node>();
+    for (std::string_view path : paths) {
+        tree->add(Pointer(path).segments(), 0);
+    }
+    root = std::move(tree);
 }
-double& JsonValue::asNumber()
+Projection::Projection(const std::vector<std::string>& paths)
 {
-    return std::get<double>(value);
+    auto tree = std::make_shared<Node>();
+    for (const std::string& path : paths) {
+        tree->add(Pointer(path).segments(), 0);
+    }
+    root = std::move(tree);
 }
-std::string& JsonValue::asString()
+const Projection::Node& Projection::tree() const
 {
-    return std::get<std::string>(value);
+    return *root;
 }
-JsonArray& JsonValue::asArray()
+InternPool::InternPool(size_t maxStrings, size_t maxLength, bool threadSafe)
+  : maxStringCount(maxStrings), maxStringLength(maxLength),
+    threadSafe(threadSafe)
 {
-    return std::get<JsonArray>(value);
 }
-JsonObject& JsonValue::asObject()
+InternedString InternPool::intern(std::string_view str)
 {
-    return std::get<JsonObject>(value);
+    if (str.length() > maxStringLength) {
+        return nullptr;
+    }
+
+    // the common case is that it's already in here, which only needs reading
+    {
+        std::shared_lock<std::shared_mutex> lock;
+        if (threadSafe) {
+            lock = std::shared_lock(mutex);
+        }
+        auto it = strings.find(str);
+        if (it != strings.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock;
+    if (threadSafe) {
+        lock = std::unique_lock(mutex);
+    }
+    // someone else might have added it in the meantime
+    auto it = strings.find(str);
+    if (it != strings.end()) {
+        return it->second;
+    }
+    if (strings.size() >= maxStringCount) {
+        return nullptr;
+    }
+    auto interned = std::make_shared<const std::string>(str);
+    // the key views the pooled string itself
+    strings.emplace(*interned, interned);
+    return interned;
 }
-const bool& JsonValue::asBool() const
+size_t InternPool::size() const
 {
-    return std::get<bool>(value);
+    std::shared_lock<std::shared_mutex> lock;
+    if (threadSafe) {
+        lock = std::shared_lock(mutex);
+    }
+    return strings.size();
 }
-const double& JsonValue::asNumber() const
+size_t InternPool::maxLength() const
 {
-    return std::get<double>(value);
+    return maxStringLength;
 }
-const std::string& JsonValue::asString() const
+struct RawJson::State
 {
-    return std::get<std::string>(value);
+    // empty when borrowed
+    std::string owned;
+    std::string_view text;
+    bool borrowed = false;
+
+    std::once_flag parseOnce;
+    std::unique_ptr<JsonValue> parsed;
+};
+
+RawJson::RawJson(std::string text) : state(std::make_shared<State>())
+{
+    state->owned = std::move(text);
+    state->text = state->owned;
 }
-const JsonArray& JsonValue::asArray() const
+RawJson RawJson::borrow(std::string_view text)
 {
-    return std::get<JsonArray>(value);
+    RawJson raw;
+    raw.state = std::make_shared<State>();
+    raw.state->text = text;
+    raw.state->borrowed = true;
+    return raw;
 }
-const JsonObject& JsonValue::asObject() const
+std::string_view RawJson::text() const
 {
-    return std::get<JsonObject>(value);
+    return state->text;
 }
-bool detail::Lexer::isAtEnd() const
+bool RawJson::borrowed() const
 {
-    return current >= source.data() + source.length();
+    return state->borrowed;
 }
-char detail::Lexer::advance()
+const JsonValue& RawJson::parsed() const
 {
-    if (isAtEnd()) {
-        return '\0';
-    }
-    current++;
-    colNum++;
-    return current[-1];
+    // if parse throws, the next call tries again
+    std::call_once(state->parseOnce, [this] {
+        state->parsed = std::make_unique<JsonValue>(parse(state->text));
+    });
+    return *state->parsed;
 }
-char detail::Lexer::peek() const
+const char* ParseError::description() const
 {
-    if (isAtEnd()) {
-        return '\0';
+    switch (code) {
+        case ErrorCode::None: return "No error.";
+        case ErrorCode::UnexpectedCharacter:
+            return "Unexpected character or unterminated literal";
+        case ErrorCode::UnterminatedString: return "Unterminated string.";
+        case ErrorCode::ExpectedValue:
+            return "Expected a value (object, array, string, number, true, "
+                   "false, or null).";
+        case ErrorCode::ExpectedKey:
+            return "Expected a string key for object member.";
+        case ErrorCode::ExpectedColon: return "Expected ':' after object key.";
+        case ErrorCode::ExpectedObjectStart:
+            return "Expected '{' to start an object.";
+        case ErrorCode::ExpectedObjectEnd:
+            return "Expected '}' to end an object.";
+        case ErrorCode::ExpectedCommaOrBrace:
+            return "Expected ',' or '}' after object member.";
+        case ErrorCode::ExpectedArrayStart:
+            return "Expected '[' to start an array.";
+        case ErrorCode::ExpectedArrayEnd:
+            return "Expected ']' to end an array.";
+        case ErrorCode::ExpectedCommaOrBracket:
+            return "Expected ',' or ']' after array element.";
+        case ErrorCode::InvalidNumber: return "Invalid number format.";
+        case ErrorCode::InvalidCharactersInNumber:
+            return "Invalid characters in number literal.";
+        case ErrorCode::NumberOutOfRange:
+            return "Number is out of range for what it's read into.";
+        case ErrorCode::InvalidEscape:
+            return "Invalid escape sequence in string.";
+        case ErrorCode::InvalidUtf8: return "String is not valid UTF-8.";
+        case ErrorCode::TrailingContent:
+            return "Unexpected content after the JSON value.";
+        case ErrorCode::WrongType:
+            return "Value has the wrong type for the field it's read into.";
     }
-    return *current;
+    return "Unknown error.";
 }
-char detail::Lexer::peekNext() const
+std::string ParseError::message() const
 {
-    if (current + 1 >= source.data() + source.length()) {
-        return '\0';
-    }
-    return current[1];
+    return std::string(description()) + " (at line " + std::to_string(line) +
+           ", col " + std::to_string(col) + ")";
 }
-void detail::Lexer::skipWhitespaceAndComments()
+ParsingError::ParsingError(const std::string& message, size_t line, size_t col)
+  : std::runtime_error(message + " (at line " + std::to_string(line) +
+                       ", col " + std::to_string(col) + ")"),
+    details{.line = line, .col = col}
 {
-    while (true) {
-        char c = peek();
-        switch (c) {
-            case ' ':
-            case '\r':
-            case '\t': advance(); break;
-            case '\n':
-                advance();
-                lineNum++;
-                colNum = 1;
-                break;
-            case '/':
-                if (peekNext() == '/') { // Single-line comment
-                    while (peek() != '\n' && !isAtEnd()) {
-                        advance();
-                    }
-                } else if (peekNext() == '*') { // Multi-line comment
-                    advance();                  // Consume '/'
-                    advance();                  // Consume '*'
-                    while ((peek() != '*' || peekNext() != '/') && !isAtEnd()) {
-                        if (peek() == '\n') {
-                            lineNum++;
-                            colNum = 1;
-                        }
-                        advance();
-                    }
-                    if (!isAtEnd()) {
-                        advance(); // Consume '*'
-                    }
-                    if (!isAtEnd()) {
-                        advance(); // Consume '/'
-                    }
-                } else {
-                    return; // Not a comment
-                }
-                break;
-            default: return;
-        }
-    }
 }
-detail::Token detail::Lexer::makeToken(TokenType type) const
+ParsingError::ParsingError(const ParseError& error)
+  : std::runtime_error(error.message()), details(error)
 {
-    return {.type = type,
-            .lexeme = std::string_view(start, current - start),
-            .line = lineStart,
-            .col = colStart};
 }
-detail::Token detail::Lexer::stringToken()
+size_t ParsingError::line() const
 {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') {
-            lineNum++;
-            colNum = 1;
-        }
-        if (peek() == '\\') {
-            // Handle escaped characters simply by advancing lmao
-            advance();
-        }
-        advance();
-    }
-
-    if (isAtEnd()) {
-        return {.type = TokenType::Unknown,
-                .lexeme = "Unterminated string.",
-                .line = lineStart,
-                .col = colStart};
-    }
-
-    advance(); // Consume the closing quote
-    return makeToken(TokenType::String);
+    return details.line;
 }
-detail::Token detail::Lexer::numberToken()
+size_t ParsingError::col() const
 {
-    while (std::isdigit(peek()) != 0) {
-        advance();
-    }
-    if (peek() == '.' && (std::isdigit(peekNext()) != 0)) {
-        advance(); // Consume '.'
-        while (std::isdigit(peek()) != 0) {
-            advance();
-        }
-    }
-    if (peek() == 'e' || peek() == 'E') {
-        advance();
-        if (peek() == '+' || peek() == '-') {
-            advance();
-        }
-        while (std::isdigit(peek()) != 0) {
-            advance();
-        }
-    }
-    return makeToken(TokenType::Number);
+    return details.col;
 }
-detail::Token detail::Lexer::identifierToken()
+size_t ParsingError::offset() const
 {
-    while (std::isalpha(peek()) != 0) {
-        advance();
-    }
-
-    std::string_view text(start, current - start);
-    if (text == "true") {
-        return makeToken(TokenType::True);
-    }
-    if (text == "false") {
-        return makeToken(TokenType::False);
-    }
-    if (text == "null") {
-        return makeToken(TokenType::Null);
-    }
-
-    return makeToken(TokenType::Unknown);
+    return details.offset;
 }
-detail::Lexer::Lexer(std::string_view source)
-  : source(source), start(source.data()), current(source.data())
+ErrorCode ParsingError::code() const
 {
+    return details.code;
 }
-detail::Token detail::Lexer::nextToken()
+detail::ObjectKeys::ObjectKeys(const ObjectKeys& other)
+  : names(other.names), hashes(other.hashes), index(other.index)
 {
-    skipWhitespaceAndComments();
-    start = current;
-    lineStart = lineNum;
-    colStart = colNum;
-
-    if (isAtEnd()) {
-        return makeToken(TokenType::EndOfFile);
-    }
-
-    char c = advance();
-    switch (c) {
-        case '{': return makeToken(TokenType::LeftBrace);
-        case '}': return makeToken(TokenType::RightBrace);
-        case '[': return makeToken(TokenType::LeftBracket);
-        case ']': return makeToken(TokenType::RightBracket);
-        case ',': return makeToken(TokenType::Comma);
-        case ':': return makeToken(TokenType::Colon);
-        case '"': return stringToken();
-        default:
-            if ((std::isdigit(c) != 0) || c == '-') {
-                return numberToken();
-            }
-            if (std::isalpha(c) != 0) {
-                return identifierToken();
-            }
+}
+void detail::SharedKeys::release()
+{
+    if (keys != nullptr &&
+        keys->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        delete keys;
     }
-
-    return makeToken(TokenType::Unknown);
+    keys = nullptr;
 }
-Parser::Parser(std::string_view source) : lexer(source)
+detail::SharedKeys::SharedKeys(ObjectKeys* keys) : keys(keys)
 {
-    // Prime the pump :)
-    advance();
 }
-void Parser::advance()
+detail::SharedKeys::SharedKeys(const SharedKeys& other) : keys(other.keys)
 {
-    previousToken = currentToken;
-    currentToken = lexer.nextToken();
-    if (currentToken.type == detail::TokenType::Unknown) {
-        throw ParsingError("Unexpected character or unterminated literal",
-                           currentToken.line, currentToken.col);
+    if (keys != nullptr) {
+        keys->refCount.fetch_add(1, std::memory_order_relaxed);
     }
 }
-void Parser::consume(detail::TokenType type, const std::string& message)
+detail::SharedKeys::SharedKeys(SharedKeys&& other) noexcept
+  : keys(std::exchange(other.keys, nullptr))
 {
-    if (currentToken.type == type) {
-        advance();
-        return;
-    }
-    throw ParsingError(message, currentToken.line, currentToken.col);
 }
-JsonValue Parser::parseValue()
+detail::SharedKeys& detail::SharedKeys::operator=(const SharedKeys& other)
 {
-    switch (currentToken.type) {
-        case detail::TokenType::LeftBrace: return parseObject();
-        case detail::TokenType::LeftBracket: return parseArray();
-        case detail::TokenType::String: return parseString();
-        case detail::TokenType::Number: return parseNumber();
-        case detail::TokenType::True: advance(); return {true};
-        case detail::TokenType::False: advance(); return {false};
-        case detail::TokenType::Null: advance(); return {nullptr};
-        default:
-            throw ParsingError("Expected a value (object, array, string, "
-                               "number, true, false, or null).",
-                               currentToken.line, currentToken.col);
+    if (this != &other) {
+        SharedKeys copy(other);
+        *this = std::move(copy);
     }
+    return *this;
 }
-JsonValue Parser::parseString()
+detail::SharedKeys& detail::SharedKeys::operator=(SharedKeys&& other) noexcept
 {
-    // The lexeme includes the quotes, so we create a substring without
-    // them. We also need to unescape the characters
-    std::string result;
-    auto view = currentToken.lexeme;
-    result.reserve(view.length() - 2);
-    for (size_t i = 1; i < view.length() - 1; ++i) {
-        if (view[i] == '\\' && i + 1 < view.length() - 1) {
-            i++;
-            switch (view[i]) {
-                case '"': result += '"'; break;
-                case '\\': result += '\\'; break;
-                case '/': result += '/'; break;
-                case 'b': result += '\b'; break;
-                case 'f': result += '\f'; break;
-                case 'n': result += '\n'; break;
-                case 'r': result += '\r'; break;
-                case 't': result += '\t'; break;
-                // uhhhh unicode escapes are complex, so we'll skip a full
-                // implementation. if you're putting unicode escape
-                // sequences in the JSON file...why...just why
-                default: result += view[i]; // just add the character as is
-            }
-        } else {
-            result += view[i];
-        }
+    if (this != &other) {
+        release();
+        keys = std::exchange(other.keys, nullptr);
     }
-    advance();
-    return {std::move(result)};
+    return *this;
 }
-JsonValue Parser::parseNumber()
+detail::SharedKeys::~SharedKeys()
 {
-    std::string numStr(currentToken.lexeme);
-    try {
-        size_t pos = 0;
-        double value = std::stod(numStr, &pos);
+    release();
+}
+bool detail::SharedKeys::unique() const
+{
+    return keys->refCount.load(std::memory_order_acquire) == 1;
+}
+size_t JsonObject::hashKey(std::string_view key)
+{
+    return std::hash<std::string_view>{}(key);
+}
+size_t JsonObject::position(std::string_view key, size_t hash) const
+{
+    if (!keys) {
+        return 0;
+    }
+
+    const auto& names = keys->names;
+    const auto& hashes = keys->hashes;
+    const auto& index = keys->index;
+    if (index.empty()) {
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            if (hashes[i] == hash && names[i].str() == key) {
+                return i;
+            }
+        }
+        return size();
+    }
+
+    const size_t mask = index.size() - 1;
+    for (size_t slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask)
+    {
+        size_t i = index[slot] - 1;
+        if (hashes[i] == hash && names[i].str() == key) {
+            return i;
+        }
+    }
+    return size();
+}
+void JsonObject::indexMember(size_t pos)
+{
+    auto& index = keys->index;
+    // keep the index at most half full
+    if (index.size() < 2 * size()) {
+        rebuildIndex();
+        return;
+    }
+    const size_t mask = index.size() - 1;
+    size_t slot = keys->hashes[pos] & mask;
+    while (index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    index[slot] = static_cast<uint32_t>(pos + 1);
+}
+void JsonObject::rebuildIndex()
+{
+    auto& index = keys->index;
+    index.clear();
+    if (size() <= indexThreshold) {
+        return;
+    }
+    index.resize(std::bit_ceil(4 * size()));
+    const size_t mask = index.size() - 1;
+    for (size_t i = 0; i < size(); ++i) {
+        size_t slot = keys->hashes[i] & mask;
+        while (index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+JsonObject::JsonObject(detail::SharedKeys keys, std::vector<JsonValue> values)
+  : keys(std::move(keys)), memberValues(std::move(values))
+{
+}
+detail::ObjectKeys& JsonObject::ownKeys()
+{
+    if (!keys) {
+        keys = detail::SharedKeys(new detail::ObjectKeys());
+    } else if (!keys.unique()) {
+        keys = detail::SharedKeys(new detail::ObjectKeys(*keys.get()));
+    }
+    return *keys.get();
+}
+size_t JsonObject::size() const
+{
+    return memberValues.size();
+}
+bool JsonObject::empty() const
+{
+    return memberValues.empty();
+}
+void JsonObject::clear()
+{
+    keys = {};
+    memberValues.clear();
+}
+void JsonObject::reserve(size_t count)
+{
+    // don't make (or unshare) a key table just to reserve nothing
+    if (count <= size()) {
+        return;
+    }
+    auto& own = ownKeys();
+    own.names.reserve(count);
+    own.hashes.reserve(count);
+    memberValues.reserve(count);
+}
+JsonObject::iterator JsonObject::begin()
+{
+    return {this, 0};
+}
+JsonObject::iterator JsonObject::end()
+{
+    return {this, size()};
+}
+JsonObject::const_iterator JsonObject::begin() const
+{
+    return {this, 0};
+}
+JsonObject::const_iterator JsonObject::end() const
+{
+    return {this, size()};
+}
+JsonObject::const_iterator JsonObject::cbegin() const
+{
+    return begin();
+}
+JsonObject::const_iterator JsonObject::cend() const
+{
+    return end();
+}
+JsonObject::iterator JsonObject::find(std::string_view key)
+{
+    return find(key, hashKey(key));
+}
+JsonObject::const_iterator JsonObject::find(std::string_view key) const
+{
+    return find(key, hashKey(key));
+}
+size_t JsonObject::count(std::string_view key) const
+{
+    return contains(key) ? 1 : 0;
+}
+bool JsonObject::contains(std::string_view key) const
+{
+    return position(key, hashKey(key)) != size();
+}
+JsonObject::iterator JsonObject::find(std::string_view key, size_t hash)
+{
+    return {this, position(key, hash)};
+}
+JsonObject::const_iterator JsonObject::find(std::string_view key,
+                                            size_t hash) const
+{
+    return {this, position(key, hash)};
+}
+JsonValue& JsonObject::at(std::string_view key)
+{
+    size_t pos = position(key, hashKey(key));
+    if (pos == size()) {
+        detail::raise(std::out_of_range("JsonObject::at: no member \"" +
+                                        std::string(key) + "\""));
+    }
+    return memberValues[pos];
+}
+const JsonValue& JsonObject::at(std::string_view key) const
+{
+    size_t pos = position(key, hashKey(key));
+    if (pos == size()) {
+        detail::raise(std::out_of_range("JsonObject::at: no member \"" +
+                                        std::string(key) + "\""));
+    }
+    return memberValues[pos];
+}
+JsonValue& JsonObject::operator[](const std::string& key)
+{
+    return emplace(key, nullptr).first->second;
+}
+JsonValue& JsonObject::operator[](std::string&& key)
+{
+    return emplace(std::move(key), nullptr).first->second;
+}
+std::pair<JsonObject::iterator, bool> JsonObject::insert(value_type member)
+{
+    return emplace(std::move(member.first), std::move(member.second));
+}
+std::pair<JsonObject::iterator, bool> JsonObject::emplace(std::string key,
+                                                          JsonValue value)
+{
+    return emplaceKey(std::move(key), std::move(value));
+}
+std::pair<JsonObject::iterator, bool>
+JsonObject::emplaceKey(detail::KeyName key, JsonValue value)
+{
+    size_t hash = hashKey(key.str());
+    size_t pos = position(key.str(), hash);
+    if (pos != size()) {
+        return {iterator(this, pos), false};
+    }
+
+    auto& own = ownKeys();
+    own.names.push_back(std::move(key));
+    own.hashes.push_back(hash);
+    memberValues.push_back(std::move(value));
+    if (size() > indexThreshold) {
+        indexMember(pos);
+    }
+    return {iterator(this, pos), true};
+}
+std::pair<JsonObject::iterator, bool>
+JsonObject::insert_or_assign(std::string key, JsonValue value)
+{
+    auto [it, inserted] = emplace(std::move(key), nullptr);
+    it->second = std::move(value);
+    return {it, inserted};
+}
+size_t JsonObject::erase(std::string_view key)
+{
+    size_t pos = position(key, hashKey(key));
+    if (pos == size()) {
+        return 0;
+    }
+    erase(const_iterator(this, pos));
+    return 1;
+}
+JsonObject::iterator JsonObject::erase(const_iterator pos)
+{
+    auto& own = ownKeys();
+    own.names.erase(own.names.begin() + pos.pos);
+    own.hashes.erase(own.hashes.begin() + pos.pos);
+    memberValues.erase(memberValues.begin() + pos.pos);
+    // positions after pos all shifted down
+    if (!own.index.empty()) {
+        rebuildIndex();
+    }
+    return {this, pos.pos};
+}
+detail::PackedArray& detail::PackedArray::operator=(const PackedArray& other)
+{
+    if (this != &other) {
+        forget();
+        numbers = other.numbers;
+    }
+    return *this;
+}
+detail::PackedArray& detail::PackedArray::operator=(
+  PackedArray&& other) noexcept
+{
+    forget();
+    numbers = std::move(other.numbers);
+    return *this;
+}
+detail::PackedArray::~PackedArray()
+{
+    forget();
+}
+const JsonArray& detail::PackedArray::elements() const
+{
+    if (const JsonArray* made = unpacked.load(std::memory_order_acquire)) {
+        return *made;
+    }
+    // threads that get here together each make one, the first to store
+    // theirs wins and the others throw theirs away
+    auto* made = new JsonArray(numbers.begin(), numbers.end());
+    JsonArray* expected = nullptr;
+    if (!unpacked.compare_exchange_strong(expected, made,
+                                          std::memory_order_acq_rel))
+    {
+        delete made;
+        return *expected;
+    }
+    return *made;
+}
+JsonArray detail::PackedArray::release()
+{
+    if (JsonArray* made = unpacked.exchange(nullptr)) {
+        JsonArray elements = std::move(*made);
+        delete made;
+        return elements;
+    }
+    return JsonArray(numbers.begin(), numbers.end());
+}
+void detail::PackedArray::forget()
+{
+    delete unpacked.exchange(nullptr);
+}
+JsonValue::JsonValue(std::nullptr_t) : value(nullptr)
+{
+}
+JsonValue::JsonValue(bool b) : value(b)
+{
+}
+JsonValue::JsonValue(double d) : value(d)
+{
+}
+JsonValue::JsonValue(int i) : value(static_cast<double>(i))
+{
+}
+JsonValue::JsonValue(const std::string& s) : value(s)
+{
+}
+JsonValue::JsonValue(std::string&& s) : value(std::move(s))
+{
+}
+JsonValue::JsonValue(const char* s) : value(std::string(s))
+{
+}
+JsonValue::JsonValue(const JsonArray& a) : value(a)
+{
+}
+JsonValue::JsonValue(JsonArray&& a) : value(std::move(a))
+{
+}
+JsonValue::JsonValue(NumberArray&& a)
+  : value(detail::PackedArray(std::move(a)))
+{
+}
+JsonValue::JsonValue(const JsonObject& o) : value(o)
+{
+}
+JsonValue::JsonValue(JsonObject&& o) : value(std::move(o))
+{
+}
+JsonValue::JsonValue(RawJson&& r) : value(std::move(r))
+{
+}
+char JsonValue::rawStart() const
+{
+    const auto* raw = std::get_if<RawJson>(&value);
+    if (raw == nullptr) {
+        return 0;
+    }
+    std::string_view text = raw->text();
+    size_t first = text.find_first_not_of(" \t\r\n");
+    return first == std::string_view::npos ? 0 : text[first];
+}
+bool JsonValue::isNull() const
+{
+    return std::holds_alternative<std::nullptr_t>(value) || rawStart() == 'n';
+}
+bool JsonValue::isBool() const
+{
+    char start = rawStart();
+    return std::holds_alternative<bool>(value) || start == 't' || start == 'f';
+}
+bool JsonValue::isNumber() const
+{
+    char start = rawStart();
+    return std::holds_alternative<double>(value) || start == '-' ||
+           (start >= '0' && start <= '9');
+}
+bool JsonValue::isString() const
+{
+    return std::holds_alternative<std::string>(value) ||
+           std::holds_alternative<InternedString>(value) || rawStart() == '"';
+}
+bool JsonValue::isArray() const
+{
+    return std::holds_alternative<JsonArray>(value) ||
+           std::holds_alternative<detail::PackedArray>(value) ||
+           rawStart() == '[';
+}
+bool JsonValue::isObject() const
+{
+    return std::holds_alternative<JsonObject>(value) || rawStart() == '{';
+}
+bool JsonValue::isNumberArray() const
+{
+    return std::holds_alternative<detail::PackedArray>(value);
+}
+bool JsonValue::isRaw() const
+{
+    return std::holds_alternative<RawJson>(value);
+}
+JsonValue& JsonValue::materialize()
+{
+    versionStamp.bump();
+    auto* raw = std::get_if<RawJson>(&value);
+    if (raw == nullptr) {
+        return *this;
+    }
+    // nothing else can be looking at the parse if no copy shares it, so it
+    // can be moved out (or made straight here if it hasn't been yet)
+    auto& state = *raw->state;
+    if (raw->state.use_count() == 1 && state.parsed == nullptr) {
+        JsonValue parsed = parse(state.text);
+        value = std::move(parsed.value);
+    } else if (raw->state.use_count() == 1) {
+        JsonValue parsed = std::move(*state.parsed);
+        value = std::move(parsed.value);
+    } else {
+        JsonValue parsed = raw->parsed();
+        value = std::move(parsed.value);
+    }
+    return *this;
+}
+const JsonValue& JsonValue::materialize() const
+{
+    if (const auto* raw = std::get_if<RawJson>(&value)) {
+        return raw->parsed();
+    }
+    return *this;
+}
+bool& JsonValue::asBool()
+{
+    materialize();
+    return std::get<bool>(value);
+}
+double& JsonValue::asNumber()
+{
+    materialize();
+    return std::get<double>(value);
+}
+std::string& JsonValue::asString()
+{
+    materialize();
+    // the pooled copy is shared, so it can't be handed out for modifying
+    if (auto* interned = std::get_if<InternedString>(&value)) {
+        value = std::string(**interned);
+    }
+    return std::get<std::string>(value);
+}
+JsonArray& JsonValue::asArray()
+{
+    materialize();
+    if (auto* packed = std::get_if<detail::PackedArray>(&value)) {
+        value = packed->release();
+    }
+    return std::get<JsonArray>(value);
+}
+JsonObject& JsonValue::asObject()
+{
+    materialize();
+    return std::get<JsonObject>(value);
+}
+const bool& JsonValue::asBool() const
+{
+    return std::get<bool>(materialize().value);
+}
+const double& JsonValue::asNumber() const
+{
+    return std::get<double>(materialize().value);
+}
+const std::string& JsonValue::asString() const
+{
+    const auto& held = materialize().value;
+    if (const auto* interned = std::get_if<InternedString>(&held)) {
+        return **interned;
+    }
+    return std::get<std::string>(held);
+}
+const JsonArray& JsonValue::asArray() const
+{
+    const auto& held = materialize().value;
+    if (const auto* packed = std::get_if<detail::PackedArray>(&held)) {
+        return packed->elements();
+    }
+    return std::get<JsonArray>(held);
+}
+std::string_view JsonValue::asStringView() const
+{
+    return asString();
+}
+std::span<double> JsonValue::asNumberSpan()
+{
+    materialize();
+    auto& packed = std::get<detail::PackedArray>(value);
+    packed.forget();
+    return packed.numbers;
+}
+std::span<const double> JsonValue::asNumberSpan() const
+{
+    return std::get<detail::PackedArray>(materialize().value).numbers;
+}
+const RawJson& JsonValue::asRaw() const
+{
+    return std::get<RawJson>(value);
+}
+const JsonObject& JsonValue::asObject() const
+{
+    return std::get<JsonObject>(materialize().value);
+}
+const JsonValue* JsonValue::find(std::string_view key) const
+{
+    const auto* object = std::get_if<JsonObject>(&materialize().value);
+    if (object == nullptr) {
+        return nullptr;
+    }
+    auto it = object->find(key);
+    return it == object->end() ? nullptr : &it->second;
+}
+const JsonValue* JsonValue::find(const Pointer& pointer) const
+{
+    const JsonValue* current = this;
+    for (const auto& segment : pointer.segments()) {
+        current = &current->materialize();
+        if (const auto* object = std::get_if<JsonObject>(&current->value)) {
+            auto it = object->find(segment.key, segment.hash);
+            if (it == object->end()) {
+                return nullptr;
+            }
+            current = &it->second;
+        } else if (current->isArray()) {
+            const JsonArray& array = current->asArray();
+            if (!segment.index || *segment.index >= array.size()) {
+                return nullptr;
+            }
+            current = &array[*segment.index];
+        } else {
+            return nullptr;
+        }
+    }
+    return current;
+}
+JsonValue* JsonValue::find(std::string_view key)
+{
+    if (!isObject()) {
+        return nullptr;
+    }
+    auto& object = asObject();
+    auto it = object.find(key);
+    return it == object.end() ? nullptr : &it->second;
+}
+JsonValue* JsonValue::find(const Pointer& pointer)
+{
+    // walks through the non-const accessors so that Document spans along the
+    // way are dropped, the caller may well modify what we return
+    JsonValue* current = this;
+    for (const auto& segment : pointer.segments()) {
+        if (current->isObject()) {
+            auto& object = current->asObject();
+            auto it = object.find(segment.key, segment.hash);
+            if (it == object.end()) {
+                return nullptr;
+            }
+            current = &it->second;
+        } else if (current->isArray()) {
+            auto& array = current->asArray();
+            if (!segment.index || *segment.index >= array.size()) {
+                return nullptr;
+            }
+            current = &array[*segment.index];
+        } else {
+            return nullptr;
+        }
+    }
+    return current;
+}
+uint32_t JsonValue::version() const
+{
+    return versionStamp.value();
+}
+bool detail::Lexer::isAtEnd() const
+{
+    return current >= source.data() + source.length();
+}
+bool detail::Lexer::endsAt(char c) const
+{
+    // peek() gives '\0' at the end either way, so only a '\0' needs checking
+    return c == '\0' && isAtEnd();
+}
+template <bool Padded>
+char detail::Lexer::advance()
+{
+    if constexpr (!Padded) {
+        if (isAtEnd()) {
+            return '\0';
+        }
+    }
+    current++;
+    colNum++;
+    return current[-1];
+}
+template <bool Padded>
+char detail::Lexer::peek() const
+{
+    if constexpr (!Padded) {
+        if (isAtEnd()) {
+            return '\0';
+        }
+    }
+    return *current;
+}
+template <bool Padded>
+char detail::Lexer::peekNext() const
+{
+    if constexpr (!Padded) {
+        if (current + 1 >= source.data() + source.length()) {
+            return '\0';
+        }
+    }
+    return current[1];
+}
+template <bool Padded>
+void detail::Lexer::skipWhitespaceAndComments()
+{
+    while (true) {
+        char c = peek<Padded>();
+        switch (c) {
+            case ' ':
+            case '\r':
+            case '\t': advance<Padded>(); break;
+            case '\x1E': // RFC 7464 record separator, see DocumentStream
+                if (!recordSeparators) {
+                    return;
+                }
+                advance<Padded>();
+                break;
+            case '\n':
+                advance<Padded>();
+                lineNum++;
+                colNum = 1;
+                break;
+            case '/':
+                if (peekNext<Padded>() == '/') { // Single-line comment
+                    commentCount++;
+                    for (c = peek<Padded>(); c != '\n' && !endsAt(c);
+                         c = peek<Padded>())
+                    {
+                        advance<Padded>();
+                    }
+                } else if (peekNext<Padded>() == '*') { // Multi-line comment
+                    commentCount++;
+                    advance<Padded>(); // Consume '/'
+                    advance<Padded>(); // Consume '*'
+                    for (c = peek<Padded>();
+                         (c != '*' || peekNext<Padded>() != '/') && !endsAt(c);
+                         c = peek<Padded>())
+                    {
+                        if (c == '\n') {
+                            lineNum++;
+                            colNum = 1;
+                        }
+                        advance<Padded>();
+                    }
+                    if (!isAtEnd()) {
+                        advance<Padded>(); // Consume '*'
+                    }
+                    if (!isAtEnd()) {
+                        advance<Padded>(); // Consume '/'
+                    }
+                } else {
+                    return; // Not a comment
+                }
+                break;
+            default: return;
+        }
+    }
+}
+detail::Token detail::Lexer::makeToken(TokenType type) const
+{
+    return {.type = type,
+            .lexeme = std::string_view(start, current - start),
+            .line = lineStart,
+            .col = colStart};
+}
+template <bool Padded>
+void detail::Lexer::skipPlainStringBytes()
+{
+    // eight bytes at a time until one of them is a quote, backslash, newline,
+    // '\0' or not ASCII. with padding reading past the end is fine, without
+    // it the last few bytes are left to the byte by byte loop.
+    constexpr uint64_t ones = 0x0101010101010101;
+    constexpr uint64_t highs = 0x8080808080808080;
+    auto hasByte = [](uint64_t word, char c) {
+        uint64_t x = word ^ (ones * static_cast<uint8_t>(c));
+        return (x - ones) & ~x & highs;
+    };
+    const char* end = source.data() + source.length();
+    while (Padded || end - current >= 8) {
+        uint64_t word;
+        std::memcpy(&word, current, sizeof(word));
+        uint64_t found = hasByte(word, '"') | hasByte(word, '\\') |
+                         hasByte(word, '\n') | hasByte(word, '\0') |
+                         (word & highs);
+        if (found != 0) {
+            // the first byte in memory is the word's lowest on little endian
+            // targets and its highest on big endian ones. hasByte's borrow
+            // can flag bytes above a real match too, which on big endian
+            // are earlier in memory: that only stops the skip early, and the
+            // caller's byte by byte loop carries on from there.
+            size_t skip = 0;
+            if constexpr (std::endian::native == std::endian::little) {
+                skip = std::countr_zero(found) / 8;
+            } else {
+                skip = std::countl_zero(found) / 8;
+            }
+            current += skip;
+            colNum += skip;
+            return;
+        }
+        current += sizeof(word);
+        colNum += sizeof(word);
+    }
+}
+template <bool Padded>
+char detail::Lexer::peekAt(size_t offset) const
+{
+    if constexpr (!Padded) {
+        if (offset >= static_cast<size_t>(source.data() + source.length() -
+                                          current))
+        {
+            return '\0';
+        }
+    }
+    return current[offset];
+}
+template <bool Padded>
+bool detail::Lexer::skipEscape()
+{
+    // current is on the character after the backslash
+    switch (peek<Padded>()) {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't': advance<Padded>(); return true;
+        case 'u':
+            for (size_t i = 1; i <= 4; ++i) {
+                if (std::isxdigit(static_cast<unsigned char>(
+                      peekAt<Padded>(i))) == 0)
+                {
+                    return false;
+                }
+            }
+            current += 5;
+            colNum += 5;
+            return true;
+        default: return false;
+    }
+}
+detail::Token detail::Lexer::failToken(ErrorCode code)
+{
+    problem = code;
+    return makeToken(TokenType::Unknown);
+}
+template <bool Padded>
+detail::Token detail::Lexer::stringToken()
+{
+    // checks escapes and UTF-8 on the way, so a string token is always
+    // valid and unescapeString doesn't have to check again
+    bool escaped = false;
+    skipPlainStringBytes<Padded>();
+    for (char c = peek<Padded>(); c != '"' && !endsAt(c); c = peek<Padded>()) {
+        if (c == '\n') {
+            lineNum++;
+            colNum = 1;
+            advance<Padded>();
+        } else if (c == '\\') {
+            escaped = true;
+            advance<Padded>();
+            if (isAtEnd()) {
+                break;
+            }
+            if (!skipEscape<Padded>()) {
+                return failToken(ErrorCode::InvalidEscape);
+            }
+        } else if ((static_cast<unsigned char>(c) & 0x80) != 0) {
+            size_t length = utf8SequenceLength(
+              current, source.data() + source.length() - current);
+            if (length == 0) {
+                return failToken(ErrorCode::InvalidUtf8);
+            }
+            current += length;
+            colNum += length;
+        } else {
+            advance<Padded>();
+        }
+        skipPlainStringBytes<Padded>();
+    }
+
+    if (isAtEnd()) {
+        return failToken(ErrorCode::UnterminatedString);
+    }
+
+    advance<Padded>(); // Consume the closing quote
+    Token token = makeToken(TokenType::String);
+    token.escaped = escaped;
+    return token;
+}
+template <bool Padded>
+detail::Token detail::Lexer::numberToken()
+{
+    while (std::isdigit(peek<Padded>()) != 0) {
+        advance<Padded>();
+    }
+    if (peek<Padded>() == '.' && (std::isdigit(peekNext<Padded>()) != 0)) {
+        advance<Padded>(); // Consume '.'
+        while (std::isdigit(peek<Padded>()) != 0) {
+            advance<Padded>();
+        }
+    }
+    if (peek<Padded>() == 'e' || peek<Padded>() == 'E') {
+        advance<Padded>();
+        if (peek<Padded>() == '+' || peek<Padded>() == '-') {
+            advance<Padded>();
+        }
+        while (std::isdigit(peek<Padded>()) != 0) {
+            advance<Padded>();
+        }
+    }
+    return makeToken(TokenType::Number);
+}
+template <bool Padded>
+detail::Token detail::Lexer::identifierToken()
+{
+    while (std::isalpha(peek<Padded>()) != 0) {
+        advance<Padded>();
+    }
+
+    std::string_view text(start, current - start);
+    if (text == "true") {
+        return makeToken(TokenType::True);
+    }
+    if (text == "false") {
+        return makeToken(TokenType::False);
+    }
+    if (text == "null") {
+        return makeToken(TokenType::Null);
+    }
+
+    return failToken(ErrorCode::UnexpectedCharacter);
+}
+detail::Lexer::Lexer(std::string_view source, bool padded,
+                     bool recordSeparators)
+  : source(source), start(source.data()), current(source.data()),
+    padded(padded), recordSeparators(recordSeparators)
+{
+}
+detail::Token detail::Lexer::nextToken()
+{
+    // one branch per token here instead of a bounds check on every byte
+    return padded ? lex<true>() : lex<false>();
+}
+ErrorCode detail::Lexer::skipContainer()
+{
+    return padded ? skipContainer<true>() : skipContainer<false>();
+}
+template <bool Padded>
+ErrorCode detail::Lexer::skipContainer()
+{
+    // which of the open containers are objects, a bit each with the
+    // innermost at the bottom. past 64 levels the outer ones' bits go in
+    // deeper.
+    uint64_t objects = *start == '{' ? 1 : 0;
+    std::vector<bool> deeper;
+    size_t depth = 1;
+    while (true) {
+        char c = peek<Padded>();
+        switch (c) {
+            case '{':
+            case '[':
+                if (depth >= 64) {
+                    deeper.push_back((objects >> 63) != 0);
+                }
+                objects = (objects << 1) | (c == '{' ? 1 : 0);
+                depth++;
+                advance<Padded>();
+                break;
+            case '}':
+            case ']':
+                // the same errors parsing it would give
+                if (((objects & 1) != 0) != (c == '}')) {
+                    return (objects & 1) != 0
+                           ? ErrorCode::ExpectedCommaOrBrace
+                           : ErrorCode::ExpectedCommaOrBracket;
+                }
+                advance<Padded>();
+                if (--depth == 0) {
+                    return ErrorCode::None;
+                }
+                objects >>= 1;
+                if (depth >= 64) {
+                    objects |= static_cast<uint64_t>(deeper.back()) << 63;
+                    deeper.pop_back();
+                }
+                break;
+            case '"':
+                advance<Padded>();
+                while (true) {
+                    skipPlainStringBytes<Padded>();
+                    c = peek<Padded>();
+                    if (endsAt(c)) {
+                        return ErrorCode::UnterminatedString;
+                    }
+                    advance<Padded>();
+                    if (c == '"') {
+                        break;
+                    }
+                    if (c == '\\') {
+                        advance<Padded>();
+                    } else if (c == '\n') {
+                        lineNum++;
+                        colNum = 1;
+                    }
+                }
+                break;
+            case '\n':
+                advance<Padded>();
+                lineNum++;
+                colNum = 1;
+                break;
+            case '/':
+                if (peekNext<Padded>() == '/' || peekNext<Padded>() == '*') {
+                    skipWhitespaceAndComments<Padded>();
+                } else {
+                    advance<Padded>();
+                }
+                break;
+            case '\0':
+                if (isAtEnd()) {
+                    return ErrorCode::ExpectedValue;
+                }
+                advance<Padded>();
+                break;
+            default: advance<Padded>();
+        }
+    }
+}
+template <bool Padded>
+detail::Token detail::Lexer::lex()
+{
+    skipWhitespaceAndComments<Padded>();
+    start = current;
+    lineStart = lineNum;
+    colStart = colNum;
+
+    if (isAtEnd()) {
+        return makeToken(TokenType::EndOfFile);
+    }
+
+    char c = advance<Padded>();
+    switch (c) {
+        case '{': return makeToken(TokenType::LeftBrace);
+        case '}': return makeToken(TokenType::RightBrace);
+        case '[': return makeToken(TokenType::LeftBracket);
+        case ']': return makeToken(TokenType::RightBracket);
+        case ',': return makeToken(TokenType::Comma);
+        case ':': return makeToken(TokenType::Colon);
+        case '"': return stringToken<Padded>();
+        default:
+            if ((std::isdigit(c) != 0) || c == '-') {
+                return numberToken<Padded>();
+            }
+            if (std::isalpha(c) != 0) {
+                return identifierToken<Padded>();
+            }
+    }
+
+    return failToken(ErrorCode::UnexpectedCharacter);
+}
+const char* detail::Lexer::position() const
+{
+    return current;
+}
+size_t detail::Lexer::comments() const
+{
+    return commentCount;
+}
+ErrorCode detail::Lexer::error() const
+{
+    return problem;
+}
+
+void detail::countChildren(std::string_view source,
+                           std::vector<uint32_t>& counts,
+                           std::vector<std::pair<size_t, bool>>& open)
+{
+    counts.clear();
+    open.clear();
+
+    const char* p = source.data();
+    const char* end = p + source.length();
+    auto sawContent = [&] {
+        if (!open.empty() && !open.back().second) {
+            open.back().second = true;
+            counts[open.back().first]++;
+        }
+    };
+    while (p < end) {
+        switch (*p) {
+            case '{':
+            case '[':
+                sawContent();
+                open.emplace_back(counts.size(), false);
+                counts.push_back(0);
+                ++p;
+                break;
+            case '}':
+            case ']':
+                if (!open.empty()) {
+                    open.pop_back();
+                }
+                ++p;
+                break;
+            case ',':
+                // the next child starts when its content does, so a trailing
+                // comma doesn't count one
+                if (!open.empty()) {
+                    open.back().second = false;
+                }
+                ++p;
+                break;
+            case '"':
+                sawContent();
+                for (++p; p < end && *p != '"'; ++p) {
+                    if (*p == '\\') {
+                        ++p;
+                    }
+                }
+                ++p;
+                break;
+            case '/':
+                if (p + 1 < end && p[1] == '/') {
+                    while (p < end && *p != '\n') {
+                        ++p;
+                    }
+                    break;
+                }
+                if (p + 1 < end && p[1] == '*') {
+                    p += 2;
+                    while (p + 1 < end && (p[0] != '*' || p[1] != '/')) {
+                        ++p;
+                    }
+                    p += 2;
+                    break;
+                }
+                sawContent();
+                ++p;
+                break;
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+            case ':': ++p; break;
+            default:
+                sawContent();
+                ++p;
+                break;
+        }
+    }
+}
+size_t detail::countContainers(std::string_view source)
+{
+    size_t count = 0;
+    const char* p = source.data();
+    const char* end = p + source.length();
+    while (p < end) {
+        switch (*p) {
+            case '{':
+            case '[':
+                count++;
+                ++p;
+                break;
+            case '"':
+                for (++p; p < end && *p != '"'; ++p) {
+                    if (*p == '\\') {
+                        ++p;
+                    }
+                }
+                ++p;
+                break;
+            case '/':
+                if (p + 1 < end && p[1] == '/') {
+                    while (p < end && *p != '\n') {
+                        ++p;
+                    }
+                    break;
+                }
+                if (p + 1 < end && p[1] == '*') {
+                    p += 2;
+                    while (p + 1 < end && (p[0] != '*' || p[1] != '/')) {
+                        ++p;
+                    }
+                    p += 2;
+                    break;
+                }
+                ++p;
+                break;
+            default: ++p;
+        }
+    }
+    return count;
+}
+std::string detail::unescapeString(std::string_view lexeme)
+{
+    std::string result;
+    unescapeString(lexeme, result);
+    return result;
+}
+void detail::unescapeString(std::string_view lexeme, std::string& result)
+{
+    // The lexeme includes the quotes, so we create a substring without
+    // them. the lexer already checked every escape in it.
+    std::string_view view = lexeme.substr(1, lexeme.length() - 2);
+    result.clear();
+
+    // most strings have no escapes at all, and the rest mostly long runs
+    // without any, so copy those runs in one go
+    size_t pos = 0;
+    while (true) {
+        size_t backslash = view.find('\\', pos);
+        result.append(view.substr(pos, backslash - pos));
+        if (backslash == std::string_view::npos || backslash + 1 == view.size())
+        {
+            return;
+        }
+        pos = backslash + 2;
+        switch (view[backslash + 1]) {
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': pos = appendUnicodeEscape(view, pos, result); break;
+            default: result += view[backslash + 1]; // '"', '\\' and '/'
+        }
+    }
+}
+size_t detail::appendUnicodeEscape(std::string_view view, size_t pos,
+                                   std::string& result)
+{
+    size_t end = decodeUnicodeEscape(view, pos, [&](char c) { result += c; });
+    if (end == pos) {
+        result += 'u';
+    }
+    return end;
+}
+ErrorCode detail::fromChars(std::string_view lexeme, double& value)
+{
+    const char* end = lexeme.data() + lexeme.length();
+    auto [ptr, ec] = std::from_chars(lexeme.data(), end, value);
+    if (ec == std::errc::invalid_argument) {
+        return ErrorCode::InvalidNumber;
+    }
+    if (ec == std::errc::result_out_of_range) {
+        return ErrorCode::NumberOutOfRange;
+    }
+    if (ptr != end) {
+        return ErrorCode::InvalidCharactersInNumber;
+    }
+    return ErrorCode::None;
+}
+detail::TokenReader::TokenReader(std::string_view source)
+  : lexer(skipByteOrderMark(source)), origin(source.data())
+{
+    advance();
+}
+void detail::TokenReader::fail(ErrorCode code)
+{
+    if (current.type == TokenType::Unknown) {
+        code = lexer.error();
+    }
+    raise(ParsingError(ParseError{
+      .code = code,
+      .offset = static_cast<size_t>(current.lexeme.data() - origin),
+      .line = current.line,
+      .col = current.col}));
+}
+void detail::TokenReader::advance()
+{
+    current = lexer.nextToken();
+}
+void detail::TokenReader::consume(TokenType type, ErrorCode code)
+{
+    if (current.type != type) {
+        fail(code);
+    }
+    advance();
+}
+std::string_view detail::TokenReader::text()
+{
+    if (current.escaped) {
+        unescapeString(current.lexeme, scratch);
+        return scratch;
+    }
+    return current.lexeme.substr(1, current.lexeme.size() - 2);
+}
+void detail::TokenReader::skipValue()
+{
+    switch (current.type) {
+        case TokenType::LeftBrace:
+        case TokenType::LeftBracket:
+            if (auto code = lexer.skipContainer(); code != ErrorCode::None) {
+                fail(code);
+            }
+            advance();
+            return;
+        case TokenType::String:
+        case TokenType::Number:
+        case TokenType::True:
+        case TokenType::False:
+        case TokenType::Null: advance(); return;
+        default: fail(ErrorCode::ExpectedValue);
+    }
+}
+JsonValue detail::TokenReader::parseValue()
+{
+    // the parser carries on from our lexer and hands it back afterwards
+    Parser parser({});
+    parser.lexer = lexer;
+    parser.currentToken = current;
+    parser.origin = origin;
+    JsonValue value;
+    parser.parseValue(value);
+    if (parser.failed()) {
+        raise(ParsingError(parser.error));
+    }
+    lexer = parser.lexer;
+    current = parser.currentToken;
+    return value;
+}
+
+Parser::Parser(const ParseOptions& options) : lexer({}), options(options)
+{
+}
+Parser::Parser(std::string_view source, bool padded,
+               const ParseOptions& options)
+  : Parser(options)
+{
+    start(source, padded);
+}
+void Parser::start(std::string_view source, bool padded)
+{
+    // everything but the buffers, which we want to keep
+    lexer = detail::Lexer(detail::skipByteOrderMark(source), padded,
+                          recordSeparators);
+    currentToken = {};
+    previousToken = {};
+    commentsBeforeCurrent = 0;
+    depth = 0;
+    nextContainer = 0;
+    error = {};
+    origin = source.data();
+    rawCursor =
+      options.rawPaths != nullptr ? &options.rawPaths->tree() : nullptr;
+    if (options.precount) {
+        detail::countChildren(source, childCounts, openContainers);
+    }
+    // Prime the pump :)
+    advance();
+}
+bool Parser::failed() const
+{
+    return error.code != ErrorCode::None;
+}
+void Parser::fail(ErrorCode code)
+{
+    // the first error is the one that counts, the rest are fallout
+    if (failed()) {
+        return;
+    }
+    // whatever was expected, a token the lexer couldn't make sense of is
+    // the real problem
+    if (currentToken.type == detail::TokenType::Unknown) {
+        code = lexer.error();
+    }
+    error = {.code = code,
+             .offset = static_cast<size_t>(currentToken.lexeme.data() - origin),
+             .line = currentToken.line,
+             .col = currentToken.col};
+}
+void Parser::advance()
+{
+    previousToken = currentToken;
+    commentsBeforeCurrent = lexer.comments();
+    // an Unknown token only becomes an error once something looks at it,
+    // so parsePrefix can stop in front of garbage after its value
+    currentToken = lexer.nextToken();
+}
+bool Parser::consume(detail::TokenType type, ErrorCode code)
+{
+    if (currentToken.type == type) {
+        advance();
+        return true;
+    }
+    fail(code);
+    return false;
+}
+void Parser::parseValue(JsonValue& target)
+{
+    // a DocumentParser parses into the values it parsed last time, anything
+    // that remembered their version() has to see them change
+    target.versionStamp.bump();
+    if (spans == nullptr) {
+        parseValueContents(target);
+        return;
+    }
+
+    const char* begin = currentToken.lexeme.data();
+    size_t comments = lexer.comments();
+    parseValueContents(target);
+
+    // comments skipped while lexing the lookahead token aren't part of it
+    if (commentsBeforeCurrent == comments) {
+        const char* end =
+          previousToken.lexeme.data() + previousToken.lexeme.length();
+        lastSpan = std::string_view(begin, end - begin);
+    } else {
+        lastSpan = {};
+    }
+}
+void Parser::parseValueContents(JsonValue& target)
+{
+    switch (currentToken.type) {
+        case detail::TokenType::LeftBrace:
+            keepRaw() ? parseRaw(target) : parseObject(target);
+            return;
+        case detail::TokenType::LeftBracket:
+            keepRaw() ? parseRaw(target) : parseArray(target);
+            return;
+        case detail::TokenType::String: parseString(target); return;
+        case detail::TokenType::Number: parseNumber(target); return;
+        case detail::TokenType::True:
+            advance();
+            target.value = true;
+            return;
+        case detail::TokenType::False:
+            advance();
+            target.value = false;
+            return;
+        case detail::TokenType::Null:
+            advance();
+            target.value = nullptr;
+            return;
+        default: fail(ErrorCode::ExpectedValue); return;
+    }
+}
+void Parser::parseString(JsonValue& target)
+{
+    auto lexeme = currentToken.lexeme;
+    InternPool* pool = options.internPool;
+    if (pool != nullptr && lexeme.length() - 2 <= pool->maxLength()) {
+        std::string_view text = lexeme.substr(1, lexeme.length() - 2);
+        if (currentToken.escaped) {
+            detail::unescapeString(lexeme, scratch);
+            text = scratch;
+        }
+        if (auto interned = pool->intern(text)) {
+            advance();
+            target.value = std::move(interned);
+            return;
+        }
+    }
+
+    // write over the string that's already there, if there is one
+    if (auto* existing = std::get_if<std::string>(&target.value)) {
+        detail::unescapeString(lexeme, *existing);
+    } else {
+        target.value = detail::unescapeString(lexeme);
+    }
+    advance();
+}
+void Parser::parseNumber(JsonValue& target)
+{
+    double value = 0;
+    if (auto code = detail::parseNumber(currentToken.lexeme, value);
+        code != ErrorCode::None)
+    {
+        fail(code);
+        return;
+    }
+    advance();
+    target.value = value;
+}
+bool Parser::keepRaw() const
+{
+    return (options.rawDepth != 0 && depth >= options.rawDepth) ||
+           (rawCursor != nullptr && rawCursor->whole);
+}
+void Parser::parseRaw(JsonValue& target)
+{
+    // the opening bracket is current, the lexer is just past it
+    const char* begin = currentToken.lexeme.data();
+    size_t comments = lexer.comments();
+    checkContainer();
+    if (failed()) {
+        return;
+    }
+    std::string_view text(begin, lexer.position() - begin);
+    if (options.precount) {
+        // none of these go through expectedChildren()
+        nextContainer += detail::countContainers(text);
+    }
+
+    // raw text is plain JSON, so anything with comments in it gets parsed
+    // after all (with comments the only way to tell is looking)
+    if (lexer.comments() != comments) {
+        auto parsed = tryParse(text, false, {});
+        if (!parsed) {
+            fail(parsed.error().code);
+            return;
+        }
+        target.value = std::move(parsed->value);
+    } else if (options.borrowRaw) {
+        target.value = RawJson::borrow(text);
+    } else {
+        target.value = RawJson(std::string(text));
+    }
+    advance();
+}
+void Parser::checkContainer()
+{
+    using detail::TokenType;
+    enum class Next : uint8_t { Value, Key, Colon, CommaOrEnd };
 
-        if (pos != numStr.length()) {
-            throw ParsingError("Invalid characters in number literal.",
-                               currentToken.line, currentToken.col);
+    rawClosers.clear();
+    Next next = Next::Value;
+    // just past an opening bracket, where the container can end right away
+    bool opened = false;
+    while (true) {
+        const TokenType type = currentToken.type;
+        bool valueDone = false;
+        if (opened && type == rawClosers.back()) {
+            rawClosers.pop_back();
+            valueDone = true;
+        } else {
+            switch (next) {
+                case Next::Value:
+                    if (type == TokenType::LeftBrace ||
+                        type == TokenType::LeftBracket)
+                    {
+                        const bool object = type == TokenType::LeftBrace;
+                        rawClosers.push_back(object ? TokenType::RightBrace
+                                                    : TokenType::RightBracket);
+                        next = object ? Next::Key : Next::Value;
+                        opened = true;
+                        advance();
+                        continue;
+                    }
+                    if (type == TokenType::Number) {
+                        double number = 0;
+                        if (auto code =
+                              detail::parseNumber(currentToken.lexeme, number);
+                            code != ErrorCode::None)
+                        {
+                            fail(code);
+                            return;
+                        }
+                    } else if (type != TokenType::String &&
+                               type != TokenType::True &&
+                               type != TokenType::False &&
+                               type != TokenType::Null)
+                    {
+                        fail(ErrorCode::ExpectedValue);
+                        return;
+                    }
+                    valueDone = true;
+                    break;
+                case Next::Key:
+                    if (type != TokenType::String) {
+                        fail(ErrorCode::ExpectedKey);
+                        return;
+                    }
+                    next = Next::Colon;
+                    break;
+                case Next::Colon:
+                    if (type != TokenType::Colon) {
+                        fail(ErrorCode::ExpectedColon);
+                        return;
+                    }
+                    next = Next::Value;
+                    break;
+                case Next::CommaOrEnd: {
+                    const bool inObject =
+                      rawClosers.back() == TokenType::RightBrace;
+                    if (type == rawClosers.back()) {
+                        rawClosers.pop_back();
+                        valueDone = true;
+                    } else if (type == TokenType::Comma) {
+                        next = inObject ? Next::Key : Next::Value;
+                    } else {
+                        fail(inObject ? ErrorCode::ExpectedCommaOrBrace
+                                      : ErrorCode::ExpectedCommaOrBracket);
+                        return;
+                    }
+                    break;
+                }
+            }
+        }
+        opened = false;
+        if (valueDone) {
+            if (rawClosers.empty()) {
+                return;
+            }
+            next = Next::CommaOrEnd;
+        }
+        advance();
+    }
+}
+detail::KeyName Parser::keyName(std::string_view text, std::string& unescaped)
+{
+    if (options.internPool != nullptr) {
+        if (auto interned = options.internPool->intern(text)) {
+            return interned;
         }
+    }
+    // text is unescaped if the key had escapes in it
+    if (unescaped.empty()) {
+        unescaped = text;
+    }
+    return std::move(unescaped);
+}
+size_t Parser::expectedChildren()
+{
+    // has to be called once per container, in the order they open
+    if (nextContainer < childCounts.size()) {
+        return childCounts[nextContainer++];
+    }
+    return 0;
+}
+void Parser::holdSpan(size_t pos)
+{
+    if (spans != nullptr && !lastSpan.empty()) {
+        pendingSpans.emplace_back(pos, lastSpan);
+    }
+}
+void Parser::recordSpans(size_t first, std::vector<JsonValue>& elements)
+{
+    // a key that came up twice was parsed over, the later span is the one
+    // that goes with it and gets looked up
+    for (size_t i = first; i < pendingSpans.size(); ++i) {
+        recordSpan(elements[pendingSpans[i].first], pendingSpans[i].second);
+    }
+    pendingSpans.resize(first);
+}
+void Parser::recordSpan(JsonValue& value, std::string_view text)
+{
+    // out of stamps, it's written out again instead
+    if (spans->size() >= stampCount) {
+        return;
+    }
+    value.versionStamp.set(firstStamp + static_cast<uint32_t>(spans->size()));
+    spans->push_back(text);
+}
+JsonValue& Parser::nextElement(std::vector<JsonValue>& elements, size_t& used)
+{
+    if (used < elements.size()) {
+        return elements[used++];
+    }
+    used++;
+    return elements.emplace_back();
+}
+JsonObject Parser::objectWithKeys(const detail::SharedKeys& keys, size_t count,
+                                  std::vector<JsonValue>& values)
+{
+    JsonObject object;
+    object.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        object.emplaceKey(keys->names[i], std::move(values[i]));
+    }
+    return object;
+}
+void Parser::parseObject(JsonValue& target)
+{
+    const size_t expected = expectedChildren();
+    if (!consume(detail::TokenType::LeftBrace,
+                 ErrorCode::ExpectedObjectStart))
+    {
+        return;
+    }
+
+    if (shapeHints.size() <= depth) {
+        shapeHints.resize(depth + 1);
+    }
+    const size_t objectDepth = depth++;
+    const Projection::Node* parentCursor = rawCursor;
 
-        advance();
-        return {value};
-    } catch (const std::invalid_argument&) {
-        throw ParsingError("Invalid number format.", currentToken.line,
-                           currentToken.col);
-    } catch (const std::out_of_range&) {
-        throw ParsingError("Number is out of range for a double.",
-                           currentToken.line, currentToken.col);
+    // as long as the keys match the hint's, the values go into values and
+    // the keys aren't copied or even hashed. as soon as one doesn't, we fall
+    // back to building object the normal way.
+    //
+    // if target already is an object (DocumentParser), its keys are the
+    // better guess, and its values get parsed over in place.
+    detail::SharedKeys hint = shapeHints[objectDepth];
+    const size_t firstSpan = pendingSpans.size();
+    std::vector<JsonValue> values;
+    if (auto* existing = std::get_if<JsonObject>(&target.value);
+        existing != nullptr && existing->keys)
+    {
+        hint = existing->keys;
+        values = std::move(existing->memberValues);
     }
-}
-JsonObject Parser::parseObject()
-{
-    consume(detail::TokenType::LeftBrace, "Expected '{' to start an object.");
+    bool predicted = static_cast<bool>(hint);
+    size_t matched = 0;
     JsonObject object;
+    if (predicted) {
+        values.reserve(std::max(expected, hint->names.size()));
+    } else {
+        object.reserve(expected);
+    }
 
     if (currentToken.type != detail::TokenType::RightBrace) {
         while (true) {
             if (currentToken.type != detail::TokenType::String) {
-                throw ParsingError("Expected a string key for object member.",
-                                   currentToken.line, currentToken.col);
+                fail(ErrorCode::ExpectedKey);
+                return;
+            }
+            auto lexeme = currentToken.lexeme;
+            std::string key;
+            std::string_view keyView = lexeme.substr(1, lexeme.length() - 2);
+            if (currentToken.escaped) {
+                key = detail::unescapeString(lexeme);
+                keyView = key;
             }
-            std::string key = std::string(
-              currentToken.lexeme.substr(1, currentToken.lexeme.length() - 2));
             advance();
 
-            consume(detail::TokenType::Colon, "Expected ':' after object key.");
+            if (!consume(detail::TokenType::Colon, ErrorCode::ExpectedColon)) {
+                return;
+            }
+            if (parentCursor != nullptr) {
+                rawCursor = parentCursor->member(keyView);
+            }
 
-            object[std::move(key)] = parseValue();
+            if (predicted && matched < hint->names.size() &&
+                hint->names[matched].str() == keyView)
+            {
+                parseValue(nextElement(values, matched));
+                holdSpan(matched - 1);
+            } else {
+                if (predicted) {
+                    object = objectWithKeys(hint, matched, values);
+                    object.reserve(expected);
+                    predicted = false;
+                }
+                auto member =
+                  object.emplaceKey(keyName(keyView, key), nullptr).first;
+                parseValue(member->second);
+                holdSpan(static_cast<size_t>(member - object.begin()));
+            }
+            if (failed()) {
+                return;
+            }
 
             if (currentToken.type == detail::TokenType::RightBrace)
                 break;
-            consume(detail::TokenType::Comma,
-                    "Expected ',' or '}' after object member.");
+            if (!consume(detail::TokenType::Comma,
+                         ErrorCode::ExpectedCommaOrBrace))
+            {
+                return;
+            }
         }
     }
 
-    consume(detail::TokenType::RightBrace, "Expected '}' to end an object.");
-    return object;
+    if (!consume(detail::TokenType::RightBrace, ErrorCode::ExpectedObjectEnd)) {
+        return;
+    }
+    depth--;
+    rawCursor = parentCursor;
+
+    if (predicted) {
+        if (matched == hint->names.size()) {
+            values.resize(matched);
+            object = JsonObject(hint, std::move(values));
+        } else {
+            object = objectWithKeys(hint, matched, values);
+        }
+    }
+    if (!object.empty()) {
+        shapeHints[objectDepth] = object.keys;
+    }
+    target.value = std::move(object);
+    if (spans != nullptr) {
+        recordSpans(firstSpan,
+                    std::get<JsonObject>(target.value).memberValues);
+    }
 }
-JsonArray Parser::parseArray()
+void Parser::parseArray(JsonValue& target)
 {
-    consume(detail::TokenType::LeftBracket, "Expected '[' to start an array.");
+    const size_t expected = expectedChildren();
+    if (!consume(detail::TokenType::LeftBracket,
+                 ErrorCode::ExpectedArrayStart))
+    {
+        return;
+    }
+    depth++;
+    const Projection::Node* parentCursor = rawCursor;
+
+    // numbers go into the packed array until something that isn't a number
+    // shows up. then they're moved over and we carry on with a normal one.
+    //
+    // both start out as whatever target already holds (DocumentParser), so
+    // their memory gets reused. existing elements are parsed over in place.
+    const size_t firstSpan = pendingSpans.size();
+    NumberArray numbers;
     JsonArray array;
+    if (auto* existing = std::get_if<detail::PackedArray>(&target.value)) {
+        numbers = std::move(existing->numbers);
+        numbers.clear();
+    } else if (auto* existing = std::get_if<JsonArray>(&target.value)) {
+        array = std::move(*existing);
+    }
+    size_t used = 0;
+    bool packed = true;
+    if (currentToken.type == detail::TokenType::Number) {
+        numbers.reserve(expected);
+    }
 
     if (currentToken.type != detail::TokenType::RightBracket) {
         while (true) {
-            array.push_back(parseValue());
+            if (packed && currentToken.type == detail::TokenType::Number) {
+                double number = 0;
+                if (auto code =
+                      detail::parseNumber(currentToken.lexeme, number);
+                    code != ErrorCode::None)
+                {
+                    fail(code);
+                    return;
+                }
+                numbers.push_back(number);
+                advance();
+            } else {
+                if (packed) {
+                    array.reserve(std::max(expected, numbers.size() + 1));
+                    for (double number : numbers) {
+                        nextElement(array, used) = number;
+                    }
+                    packed = false;
+                }
+                if (parentCursor != nullptr) {
+                    rawCursor = parentCursor->element(used);
+                }
+                parseValue(nextElement(array, used));
+                if (failed()) {
+                    return;
+                }
+                holdSpan(used - 1);
+            }
             if (currentToken.type == detail::TokenType::RightBracket)
                 break;
-            consume(detail::TokenType::Comma,
-                    "Expected ',' or ']' after array element.");
+            if (!consume(detail::TokenType::Comma,
+                         ErrorCode::ExpectedCommaOrBracket))
+            {
+                return;
+            }
         }
     }
 
-    consume(detail::TokenType::RightBracket, "Expected ']' to end an array.");
-    return array;
+    if (!consume(detail::TokenType::RightBracket,
+                 ErrorCode::ExpectedArrayEnd))
+    {
+        return;
+    }
+    depth--;
+    rawCursor = parentCursor;
+    if (packed && !numbers.empty()) {
+        target.value = detail::PackedArray(std::move(numbers));
+        return;
+    }
+    array.erase(array.begin() + static_cast<ptrdiff_t>(used), array.end());
+    target.value = std::move(array);
+    if (spans != nullptr) {
+        recordSpans(firstSpan, std::get<JsonArray>(target.value));
+    }
 }
-JsonValue Parser::parse(std::string_view source)
+std::string_view detail::skipByteOrderMark(std::string_view source)
 {
     // handle a UTF-8 Byte Order Mark (BOM) if present (WHY WINDOWS WHY)
     if (source.size() >= 3 && static_cast<unsigned char>(source[0]) == 0xEF &&
@@ -515,10 +2338,489 @@ JsonValue Parser::parse(std::string_view source)
     {
         source.remove_prefix(3);
     }
+    return source;
+}
+void Parser::parseRoot(JsonValue& root, bool prefix)
+{
+    InternPool* pool = options.internPool;
+    if (pool == nullptr) {
+        parseValue(root);
+        if (!prefix) {
+            expectEnd();
+        }
+        return;
+    }
+
+    // carry the key predictions over from the last parse with this pool
+    {
+        std::shared_lock<std::shared_mutex> lock;
+        if (pool->threadSafe) {
+            lock = std::shared_lock(pool->mutex);
+        }
+        shapeHints = pool->shapeHints;
+    }
+    parseValue(root);
+    if (!prefix) {
+        expectEnd();
+    }
+    if (failed()) {
+        return;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock;
+        if (pool->threadSafe) {
+            lock = std::unique_lock(pool->mutex);
+        }
+        pool->shapeHints = shapeHints;
+    }
+}
+void Parser::expectEnd()
+{
+    if (currentToken.type != detail::TokenType::EndOfFile) {
+        fail(ErrorCode::TrailingContent);
+    }
+}
+size_t Parser::consumed() const
+{
+    // previousToken is the value's last, currentToken is already the one
+    // after it
+    return previousToken.lexeme.data() + previousToken.lexeme.length() -
+           origin;
+}
+Result<PrefixResult> Parser::tryParsePrefix(std::string_view source,
+                                            const ParseOptions& options)
+{
+    Parser parser(source, false, options);
+    JsonValue value;
+    parser.parseRoot(value, true);
+    if (parser.failed()) {
+        return {parser.error};
+    }
+    return {PrefixResult{std::move(value), parser.consumed()}};
+}
+JsonValue Parser::parse(std::string_view source, bool padded,
+                        const ParseOptions& options)
+{
+    Parser parser(source, padded, options);
+    JsonValue root;
+    parser.parseRoot(root);
+    if (parser.failed()) {
+        detail::raise(ParsingError(parser.error));
+    }
+    return root;
+}
+Result<JsonValue> Parser::tryParse(std::string_view source, bool padded,
+                                   const ParseOptions& options)
+{
+    Parser parser(source, padded, options);
+    JsonValue root;
+    parser.parseRoot(root);
+    if (parser.failed()) {
+        return {parser.error};
+    }
+    return {std::move(root)};
+}
+Result<JsonValue> Parser::tryParse(std::string_view source,
+                                   const Projection& projection)
+{
+    Parser parser(source, false, {});
+    JsonValue root;
+    const Projection::Node& tree = projection.tree();
+    if (tree.whole) {
+        parser.parseValue(root);
+    } else if (!parser.parseProjected(root, tree)) {
+        root = nullptr;
+    }
+    parser.expectEnd();
+    if (parser.failed()) {
+        return {parser.error};
+    }
+    return {std::move(root)};
+}
+void Parser::skipValue()
+{
+    switch (currentToken.type) {
+        case detail::TokenType::LeftBrace:
+        case detail::TokenType::LeftBracket:
+            if (auto code = lexer.skipContainer(); code != ErrorCode::None) {
+                fail(code);
+                return;
+            }
+            advance();
+            return;
+        case detail::TokenType::String:
+        case detail::TokenType::Number:
+        case detail::TokenType::True:
+        case detail::TokenType::False:
+        case detail::TokenType::Null: advance(); return;
+        default: fail(ErrorCode::ExpectedValue); return;
+    }
+}
+bool Parser::parseProjected(JsonValue& target, const Projection::Node& node)
+{
+    // children of what's kept whole get parsed as usual, everything that
+    // isn't on a path gets skipped. add is only called with what's kept.
+    auto parseChild = [&](const Projection::Node* child, auto&& add) {
+        if (child == nullptr) {
+            skipValue();
+            return;
+        }
+        JsonValue value;
+        if (child->whole) {
+            parseValue(value);
+        } else if (!parseProjected(value, *child)) {
+            return;
+        }
+        add(std::move(value));
+    };
+
+    if (currentToken.type == detail::TokenType::LeftBrace) {
+        advance();
+        JsonObject object;
+        bool members = currentToken.type != detail::TokenType::RightBrace;
+        while (members) {
+            if (currentToken.type != detail::TokenType::String) {
+                fail(ErrorCode::ExpectedKey);
+                return false;
+            }
+            auto lexeme = currentToken.lexeme;
+            std::string_view key = lexeme.substr(1, lexeme.length() - 2);
+            if (currentToken.escaped) {
+                detail::unescapeString(lexeme, scratch);
+                key = scratch;
+            }
+            const Projection::Node* child = node.member(key);
+            // the key is only copied if its value is kept
+            std::string kept(child != nullptr ? key : std::string_view());
+            advance();
+            if (!consume(detail::TokenType::Colon, ErrorCode::ExpectedColon)) {
+                return false;
+            }
+            parseChild(child, [&](JsonValue&& value) {
+                object.insert_or_assign(std::move(kept), std::move(value));
+            });
+            if (failed()) {
+                return false;
+            }
+            if (currentToken.type == detail::TokenType::RightBrace) {
+                break;
+            }
+            if (!consume(detail::TokenType::Comma,
+                         ErrorCode::ExpectedCommaOrBrace))
+            {
+                return false;
+            }
+        }
+        advance();
+        if (object.empty()) {
+            return false;
+        }
+        target.value = std::move(object);
+        return true;
+    }
+
+    if (currentToken.type == detail::TokenType::LeftBracket) {
+        advance();
+        JsonArray array;
+        bool elements = currentToken.type != detail::TokenType::RightBracket;
+        for (size_t index = 0; elements; ++index) {
+            parseChild(node.element(index), [&](JsonValue&& value) {
+                array.push_back(std::move(value));
+            });
+            if (failed()) {
+                return false;
+            }
+            if (currentToken.type == detail::TokenType::RightBracket) {
+                break;
+            }
+            if (!consume(detail::TokenType::Comma,
+                         ErrorCode::ExpectedCommaOrBracket))
+            {
+                return false;
+            }
+        }
+        advance();
+        if (array.empty()) {
+            return false;
+        }
+        target.value = std::move(array);
+        return true;
+    }
+
+    // a path that goes on past a string or a number doesn't match anything
+    skipValue();
+    return false;
+}
+DocumentParser::DocumentParser(const ParseOptions& options)
+  : parser(new Parser(options))
+{
+}
+DocumentParser::DocumentParser(DocumentParser&& other) noexcept = default;
+DocumentParser&
+DocumentParser::operator=(DocumentParser&& other) noexcept = default;
+DocumentParser::~DocumentParser() = default;
+JsonValue& DocumentParser::parse(std::string_view source)
+{
+    auto result = tryParse(source);
+    if (!result) {
+        detail::raise(ParsingError(result.error()));
+    }
+    return rootValue;
+}
+Result<JsonValue*> DocumentParser::tryParse(std::string_view source)
+{
+    return parseRoot(source, false);
+}
+Result<JsonValue*> DocumentParser::tryParse(PaddedView source)
+{
+    return parseRoot(source.view(), true);
+}
+JsonValue& DocumentParser::parse(PaddedView source)
+{
+    auto result = tryParse(source);
+    if (!result) {
+        detail::raise(ParsingError(result.error()));
+    }
+    return rootValue;
+}
+Result<JsonValue*> DocumentParser::parseRoot(std::string_view source,
+                                             bool padded)
+{
+    parser->start(source, padded);
+    parser->parseRoot(rootValue);
+    if (parser->failed()) {
+        rootValue = nullptr;
+        return {parser->error};
+    }
+    return {&rootValue};
+}
+JsonValue& DocumentParser::root()
+{
+    return rootValue;
+}
+const JsonValue& DocumentParser::root() const
+{
+    return rootValue;
+}
+DocumentStream::DocumentStream(std::string_view source,
+                               const ParseOptions& options)
+  : parser(new Parser(options))
+{
+    parser->recordSeparators = true;
+    parser->start(source);
+}
+DocumentStream::DocumentStream(DocumentStream&& other) noexcept = default;
+DocumentStream&
+DocumentStream::operator=(DocumentStream&& other) noexcept = default;
+DocumentStream::~DocumentStream() = default;
+JsonValue* DocumentStream::next()
+{
+    return tryNext().value();
+}
+Result<JsonValue*> DocumentStream::tryNext()
+{
+    if (parser->failed()) {
+        return {parser->error};
+    }
+    if (parser->currentToken.type == detail::TokenType::EndOfFile) {
+        return {nullptr};
+    }
+    // into the last value, so its memory gets reused (see DocumentParser)
+    parser->parseValue(currentValue);
+    if (parser->failed()) {
+        currentValue = nullptr;
+        return {parser->error};
+    }
+    return {&currentValue};
+}
+size_t DocumentStream::consumed() const
+{
+    return parser->previousToken.lexeme.data() == nullptr ? 0
+                                                          : parser->consumed();
+}
+DocumentStream::iterator DocumentStream::begin()
+{
+    return iterator(next() != nullptr ? this : nullptr);
+}
+std::default_sentinel_t DocumentStream::end()
+{
+    return {};
+}
+DocumentStream::iterator::iterator(DocumentStream* stream) : stream(stream)
+{
+}
+JsonValue& DocumentStream::iterator::operator*() const
+{
+    return stream->currentValue;
+}
+JsonValue* DocumentStream::iterator::operator->() const
+{
+    return &stream->currentValue;
+}
+DocumentStream::iterator& DocumentStream::iterator::operator++()
+{
+    if (stream->next() == nullptr) {
+        stream = nullptr;
+    }
+    return *this;
+}
+void DocumentStream::iterator::operator++(int)
+{
+    ++*this;
+}
+bool DocumentStream::iterator::operator==(std::default_sentinel_t) const
+{
+    return stream == nullptr;
+}
+Document::Document() : rootValue(std::make_unique<JsonValue>())
+{
+}
+Document::Document(std::string source, const ParseOptions& options)
+  : Document(tryParse(std::move(source), options).value())
+{
+}
+Result<Document> Document::tryParse(std::string source,
+                                    const ParseOptions& options)
+{
+    // every document gives its values versions from a range of its own,
+    // among those only documents use. a value's span starts at a byte no
+    // other value's does, so one per byte is plenty. once the ranges reach
+    // the end they start over, so it takes 2^31 bytes of documents before
+    // one's versions can look like another's.
+    static std::atomic<uint32_t> nextStamp{detail::VersionStamp::documentBit};
+    constexpr uint32_t maxStamps = detail::VersionStamp::documentBit / 4;
+
+    Document document;
+    document.text = std::make_unique<const std::string>(std::move(source));
+    const auto count = static_cast<uint32_t>(
+      std::min<size_t>(document.text->size() + 1, maxStamps));
+    uint32_t first = nextStamp.load(std::memory_order_relaxed);
+    uint32_t start = 0;
+    do {
+        start = first > UINT32_MAX - count ? detail::VersionStamp::documentBit
+                                           : first;
+    } while (!nextStamp.compare_exchange_weak(first, start + count,
+                                              std::memory_order_relaxed));
+    document.firstStamp = start;
+    Parser parser(*document.text, false, options);
+    parser.spans = &document.spans;
+    parser.firstStamp = start;
+    parser.stampCount = count;
+    parser.parseRoot(*document.rootValue);
+    if (parser.failed()) {
+        return {parser.error};
+    }
+    if (!parser.lastSpan.empty()) {
+        parser.recordSpan(*document.rootValue, parser.lastSpan);
+    }
+    document.spans.shrink_to_fit();
+    return {std::move(document)};
+}
+JsonValue& Document::root()
+{
+    return *rootValue;
+}
+const JsonValue& Document::root() const
+{
+    return *rootValue;
+}
+std::string_view Document::source() const
+{
+    return *text;
+}
+std::string_view Document::source(const JsonValue& value) const
+{
+    // values from elsewhere (or modified) wrap around to something past the
+    // end
+    const uint32_t pos = value.version() - firstStamp;
+    return pos < spans.size() ? spans[pos] : std::string_view();
+}
+const JsonValue* Document::find(const Pointer& pointer) const
+{
+    return rootValue->find(pointer);
+}
+JsonValue* Document::find(const Pointer& pointer)
+{
+    return rootValue->find(pointer);
+}
+void Document::serialise(std::ostream& os) const
+{
+    serialiseCompact(*rootValue, os, this);
+}
+namespace detail
+{
+
+// arrays and objects smaller than this aren't worth handing to other threads
+constexpr size_t parallelSerialiseThreshold = 4096;
+
+// writes the elements in [first, last) the way serialise lays them out
+// between the brackets. index is the position of first within the container
+// and total its size, so we know which element is the last one (no comma).
+// with threads > 1 the elements go through serialiseParallel, so big
+// containers nested in them get chunked too.
+template <typename Iter>
+void serialiseItems(Iter first, Iter last, size_t index, size_t total,
+                    std::ostream& os, int indent, unsigned threads = 1)
+{
+    auto serialiseItem = [&](const JsonValue& item) {
+        if (threads > 1) {
+            serialiseParallel(item, os, indent + 2, threads);
+        } else {
+            serialise(item, os, indent + 2);
+        }
+    };
+    for (; first != last; ++first, ++index) {
+        os << std::string(indent + 2, ' ');
+        using Item = std::decay_t<decltype(*first)>;
+        if constexpr (std::is_same_v<Item, JsonValue>) {
+            serialiseItem(*first);
+        } else if constexpr (std::is_same_v<Item, double>) {
+            os << *first;
+        } else {
+            os << '"' << first->first << "\": ";
+            serialiseItem(first->second);
+        }
+        if (index < total - 1) {
+            os << ",";
+        }
+        os << "\n";
+    }
+}
+
+// serialises the elements of a big container in chunks on separate threads.
+// each chunk goes into its own buffer (with the same formatting flags as os)
+// and the buffers get written out in order once everything is done.
+template <typename Container>
+void serialiseItemsParallel(const Container& container, std::ostream& os,
+                            int indent, unsigned threads)
+{
+    const size_t total = container.size();
+    const size_t chunks = std::min<size_t>(threads, total);
+    const size_t chunkSize = (total + chunks - 1) / chunks;
+
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(chunks);
+    auto first = container.begin();
+    for (size_t index = 0; index < total; index += chunkSize) {
+        auto last = std::next(first, std::min(chunkSize, total - index));
+        futures.push_back(
+          std::async(std::launch::async, [&os, first, last, index, total,
+                                          indent]() {
+              std::ostringstream buffer;
+              buffer.copyfmt(os);
+              serialiseItems(first, last, index, total, buffer, indent);
+              return std::move(buffer).str();
+          }));
+        first = last;
+    }
 
-    Parser parser(source);
-    return parser.parseValue();
+    for (auto& future : futures) {
+        os << future.get();
+    }
 }
+
+} // namespace detail
+
 void serialise(const JsonValue& val, std::ostream& os, int indent)
 {
     std::visit(
@@ -533,31 +2835,169 @@ void serialise(const JsonValue& val, std::ostream& os, int indent)
           } else if constexpr (std::is_same_v<T, std::string>) {
               os << '"' << arg << '"'; // Note: This is a simplified stringify,
                                        // doesn't escape characters.
+          } else if constexpr (std::is_same_v<T, InternedString>) {
+              os << '"' << *arg << '"';
           } else if constexpr (std::is_same_v<T, JsonArray>) {
               os << "[\n";
+              detail::serialiseItems(arg.begin(), arg.end(), 0, arg.size(), os,
+                                     indent);
+              os << std::string(indent, ' ') << "]";
+          } else if constexpr (std::is_same_v<T, detail::PackedArray>) {
+              const NumberArray& numbers = arg.numbers;
+              os << "[\n";
+              detail::serialiseItems(numbers.begin(), numbers.end(), 0,
+                                     numbers.size(), os, indent);
+              os << std::string(indent, ' ') << "]";
+          } else if constexpr (std::is_same_v<T, JsonObject>) {
+              os << "{\n";
+              detail::serialiseItems(arg.begin(), arg.end(), 0, arg.size(), os,
+                                     indent);
+              os << std::string(indent, ' ') << "}";
+          } else if constexpr (std::is_same_v<T, RawJson>) {
+              // laid out like the rest rather than pasted in as it was
+              serialise(val.materialize(), os, indent);
+          }
+      },
+      val.value);
+}
+void serialiseParallel(const JsonValue& val, std::ostream& os, int indent,
+                       unsigned threads)
+{
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    if (threads == 1) {
+        serialise(val, os, indent);
+        return;
+    }
+
+    // big containers get chunked across threads. smaller ones are walked
+    // here so that any big containers nested inside them still get chunked.
+    auto serialiseContainer = [&](const auto& container, char open,
+                                  char close) {
+        os << open << "\n";
+        if (container.size() >= detail::parallelSerialiseThreshold) {
+            detail::serialiseItemsParallel(container, os, indent, threads);
+        } else {
+            detail::serialiseItems(container.begin(), container.end(), 0,
+                                   container.size(), os, indent, threads);
+        }
+        os << std::string(indent, ' ') << close;
+    };
+
+    const auto* packed = std::get_if<detail::PackedArray>(&val.value);
+    const NumberArray* numbers = packed ? &packed->numbers : nullptr;
+    if (const auto* array = std::get_if<JsonArray>(&val.value)) {
+        serialiseContainer(*array, '[', ']');
+    } else if (numbers != nullptr &&
+               numbers->size() >= detail::parallelSerialiseThreshold)
+    {
+        os << "[\n";
+        detail::serialiseItemsParallel(*numbers, os, indent, threads);
+        os << std::string(indent, ' ') << "]";
+    } else if (const auto* object = std::get_if<JsonObject>(&val.value)) {
+        serialiseContainer(*object, '{', '}');
+    } else {
+        serialise(val, os, indent);
+    }
+}
+void detail::writeEscapedString(std::string_view str, std::ostream& os)
+{
+    os << '"';
+    writeEscaped(str, [&](const char* bytes, size_t length) {
+        os.write(bytes, static_cast<std::streamsize>(length));
+    });
+    os << '"';
+}
+void detail::writeEscapedString(std::string_view str, std::string& out)
+{
+    out += '"';
+    writeEscaped(str, [&](const char* bytes, size_t length) {
+        out.append(bytes, length);
+    });
+    out += '"';
+}
+
+void detail::writeShortestNumber(double num, std::ostream& os)
+{
+    // JSON has no way to spell inf or nan
+    if (!std::isfinite(num)) {
+        os << "null";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), num);
+    os.write(buffer, result.ptr - buffer);
+}
+void detail::writeShortestNumber(double num, std::string& out)
+{
+    if (!std::isfinite(num)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), num);
+    out.append(buffer, result.ptr - buffer);
+}
+
+void serialiseCompact(const JsonValue& val, std::ostream& os,
+                      const Document* document)
+{
+    // untouched values from the document get copied through as is
+    if (document != nullptr) {
+        const std::string_view span = document->source(val);
+        if (!span.empty()) {
+            os.write(span.data(), static_cast<std::streamsize>(span.length()));
+            return;
+        }
+    }
+
+    std::visit(
+      [&](auto&& arg) {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, std::nullptr_t>) {
+              os << "null";
+          } else if constexpr (std::is_same_v<T, bool>) {
+              os << (arg ? "true" : "false");
+          } else if constexpr (std::is_same_v<T, double>) {
+              detail::writeShortestNumber(arg, os);
+          } else if constexpr (std::is_same_v<T, std::string>) {
+              detail::writeEscapedString(arg, os);
+          } else if constexpr (std::is_same_v<T, InternedString>) {
+              detail::writeEscapedString(*arg, os);
+          } else if constexpr (std::is_same_v<T, JsonArray>) {
+              os << '[';
               for (size_t i = 0; i < arg.size(); ++i) {
-                  os << std::string(indent + 2, ' ');
-                  serialise(arg[i], os, indent + 2);
-                  if (i < arg.size() - 1) {
-                      os << ",";
+                  if (i > 0) {
+                      os << ',';
                   }
-                  os << "\n";
+                  serialiseCompact(arg[i], os, document);
               }
-              os << std::string(indent, ' ') << "]";
+              os << ']';
+          } else if constexpr (std::is_same_v<T, detail::PackedArray>) {
+              os << '[';
+              for (size_t i = 0; i < arg.numbers.size(); ++i) {
+                  if (i > 0) {
+                      os << ',';
+                  }
+                  detail::writeShortestNumber(arg.numbers[i], os);
+              }
+              os << ']';
           } else if constexpr (std::is_same_v<T, JsonObject>) {
-              os << "{\n";
-              size_t i = 0;
+              os << '{';
+              bool first = true;
               for (const auto& [key, value] : arg) {
-                  os << std::string(indent + 2, ' ');
-                  os << '"' << key << "\": ";
-                  serialise(value, os, indent + 2);
-                  if (i < arg.size() - 1) {
-                      os << ",";
+                  if (!first) {
+                      os << ',';
                   }
-                  os << "\n";
-                  i++;
+                  first = false;
+                  detail::writeEscapedString(key, os);
+                  os << ':';
+                  serialiseCompact(value, os, document);
               }
-              os << std::string(indent, ' ') << "}";
+              os << '}';
+          } else if constexpr (std::is_same_v<T, RawJson>) {
+              os << arg.text();
           }
       },
       val.value);
@@ -1,13 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <charconv>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <map>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -15,30 +29,609 @@ namespace json
 {
 
 class JsonValue;
+class Document;
+class Query;
+class Index;
 
-using JsonObject = std::map<std::string, JsonValue>;
 using JsonArray = std::vector<JsonValue>;
+// arrays of nothing but numbers are stored packed, see JsonValue
+using NumberArray = std::vector<double>;
+// a string shared through an InternPool
+using InternedString = std::shared_ptr<const std::string>;
+
+namespace detail
+{
+
+// an object key. keys the parser got from an InternPool share the pool's
+// copy, the rest have one of their own.
+class KeyName
+{
+    std::string own;
+    InternedString pooled;
+
+   public:
+    KeyName(std::string key) : own(std::move(key)) {}
+    KeyName(InternedString key) : pooled(std::move(key)) {}
+
+    [[nodiscard]] const std::string& str() const
+    {
+        return pooled ? *pooled : own;
+    }
+};
+
+// the key side of a JsonObject, its "shape": keys in insertion order, their
+// cached hashes, and (only for big objects) an open addressing hash index
+// over them. objects with the same keys in the same order share one of these,
+// so an array of a million records stores its keys once. shared key tables
+// are never modified, an object copies its keys before changing them.
+struct ObjectKeys
+{
+    std::vector<KeyName> names;
+    std::vector<size_t> hashes;
+    // slots hold a key's position + 1, 0 means empty
+    std::vector<uint32_t> index;
+
+    // number of SharedKeys pointing here
+    std::atomic<size_t> refCount = 1;
+
+    ObjectKeys() = default;
+    // copies start out unshared
+    ObjectKeys(const ObjectKeys& other);
+    ObjectKeys& operator=(const ObjectKeys&) = delete;
+};
+
+// reference counted pointer to an ObjectKeys. a std::shared_ptr would be twice
+// the size, and with it every JsonObject (and so every JsonValue).
+class SharedKeys
+{
+    ObjectKeys* keys = nullptr;
+
+    void release();
+
+   public:
+    SharedKeys() = default;
+    // takes over the reference keys was created with
+    explicit SharedKeys(ObjectKeys* keys);
+    SharedKeys(const SharedKeys& other);
+    SharedKeys(SharedKeys&& other) noexcept;
+    SharedKeys& operator=(const SharedKeys& other);
+    SharedKeys& operator=(SharedKeys&& other) noexcept;
+    ~SharedKeys();
+
+    [[nodiscard]] ObjectKeys* get() const { return keys; }
+    ObjectKeys* operator->() const { return keys; }
+    explicit operator bool() const { return keys != nullptr; }
+
+    // whether no other object shares these keys
+    [[nodiscard]] bool unique() const;
+};
+
+// how many times a JsonValue has (possibly) been modified, see
+// JsonValue::version(). copies start again from 0 and assigning to a value
+// counts as modifying it, so a value that's been replaced never looks the
+// same as before. a value that's moved takes its stamp along, the one it
+// was moved out of counts as modified.
+//
+// stamps with the top bit set are the ones a Document gives its values (see
+// there). modifying a value clears it, so it never looks like another one's.
+class VersionStamp
+{
+    uint32_t count = 0;
+
+   public:
+    static constexpr uint32_t documentBit = 1U << 31;
+
+    VersionStamp() = default;
+    VersionStamp(const VersionStamp& /*other*/) noexcept {}
+    VersionStamp(VersionStamp&& other) noexcept : count(other.count)
+    {
+        other.bump();
+    }
+    VersionStamp& operator=(const VersionStamp& /*other*/) noexcept
+    {
+        bump();
+        return *this;
+    }
+    VersionStamp& operator=(VersionStamp&& other) noexcept
+    {
+        bump();
+        other.bump();
+        return *this;
+    }
+
+    void bump() { count = (count + 1) & ~documentBit; }
+    // for Document, which marks the values it knows the source of
+    void set(uint32_t value) { count = value; }
+    [[nodiscard]] uint32_t value() const { return count; }
+};
+
+// an array of nothing but numbers as the variant holds it: the numbers,
+// and a JsonArray copy of them made the first time a const reader asks for
+// elements (so reading never changes the packed form, see JsonValue)
+class PackedArray
+{
+    mutable std::atomic<JsonArray*> unpacked = nullptr;
+
+   public:
+    NumberArray numbers;
+
+    PackedArray() = default;
+    explicit PackedArray(NumberArray numbers) : numbers(std::move(numbers))
+    {
+    }
+    // copies and moves start without the copy, it's made again if needed
+    PackedArray(const PackedArray& other) : numbers(other.numbers) {}
+    PackedArray(PackedArray&& other) noexcept
+      : numbers(std::move(other.numbers))
+    {
+    }
+    PackedArray& operator=(const PackedArray& other);
+    PackedArray& operator=(PackedArray&& other) noexcept;
+    ~PackedArray();
+
+    // the numbers as JsonValues, made once even with several threads asking
+    [[nodiscard]] const JsonArray& elements() const;
+    // takes the copy if there is one (or makes one), leaving nothing behind
+    JsonArray release();
+    // drops the copy, after the numbers were changed
+    void forget();
+};
+
+// throws e, or prints what it would have thrown and aborts when built with
+// -fno-exceptions
+template <typename Exception>
+[[noreturn]] void raise(const Exception& e)
+{
+#if defined(__cpp_exceptions)
+    throw e;
+#else
+    std::fprintf(stderr, "json: %s\n", e.what());
+    std::abort();
+#endif
+}
+
+} // namespace detail
+
+// object storage. members are kept in insertion order in flat arrays: the
+// values in one, and the keys (with their hashes) in a separate key table.
+// lookups in small objects are a linear scan over the cached hashes. once an
+// object grows past indexThreshold members, the key table also keeps a hash
+// index. an empty object allocates nothing.
+//
+// objects with identical keys can share one key table (the parser makes sure
+// they do), see detail::ObjectKeys.
+//
+// the interface mirrors std::map's, except that dereferencing an iterator
+// gives a pair of references rather than a reference to a pair. so bind with
+// `const auto& [key, value]` or `auto [key, value]`, not `auto& [...]`.
+class JsonObject
+{
+    detail::SharedKeys keys;
+    std::vector<JsonValue> memberValues;
+
+    // for the parser, which hands out shared keys
+    JsonObject(detail::SharedKeys keys, std::vector<JsonValue> values);
+    friend class Parser;
+    // which looks members up by position in objects sharing keys
+    friend class Query;
+
+    // the keys, made unshared so they can be modified
+    detail::ObjectKeys& ownKeys();
+
+    [[nodiscard]] size_t position(std::string_view key, size_t hash) const;
+    void indexMember(size_t pos);
+    void rebuildIndex();
+
+   public:
+    static constexpr size_t indexThreshold = 16;
+
+    // the hash objects use for their keys
+    static size_t hashKey(std::string_view key);
+
+    template <bool IsConst>
+    class Iterator
+    {
+        using Object = std::conditional_t<IsConst, const JsonObject, JsonObject>;
+        using Value = std::conditional_t<IsConst, const JsonValue, JsonValue>;
+
+        Object* object = nullptr;
+        size_t pos = 0;
+
+        friend class JsonObject;
+
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<std::string, JsonValue>;
+        using reference = std::pair<const std::string&, Value&>;
+
+        // so that it->first and it->second work
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        Iterator() = default;
+        Iterator(Object* object, size_t pos) : object(object), pos(pos) {}
+        // iterator -> const_iterator
+        template <bool OtherIsConst>
+            requires(IsConst && !OtherIsConst)
+        Iterator(const Iterator<OtherIsConst>& other)
+          : object(other.object), pos(other.pos)
+        {
+        }
+
+        reference operator*() const
+        {
+            return {object->keys->names[pos].str(),
+                    object->memberValues[pos]};
+        }
+        pointer operator->() const { return {**this}; }
+
+        Iterator& operator++()
+        {
+            ++pos;
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator old = *this;
+            ++pos;
+            return old;
+        }
+        Iterator& operator--()
+        {
+            --pos;
+            return *this;
+        }
+        Iterator operator--(int)
+        {
+            Iterator old = *this;
+            --pos;
+            return old;
+        }
+        Iterator& operator+=(difference_type n)
+        {
+            pos += n;
+            return *this;
+        }
+        Iterator& operator-=(difference_type n)
+        {
+            pos -= n;
+            return *this;
+        }
+        Iterator operator+(difference_type n) const
+        {
+            return Iterator(object, pos + n);
+        }
+        Iterator operator-(difference_type n) const
+        {
+            return Iterator(object, pos - n);
+        }
+        difference_type operator-(const Iterator& other) const
+        {
+            return static_cast<difference_type>(pos) -
+                   static_cast<difference_type>(other.pos);
+        }
+        bool operator==(const Iterator& other) const { return pos == other.pos; }
+        auto operator<=>(const Iterator& other) const
+        {
+            return pos <=> other.pos;
+        }
+
+        friend class Iterator<!IsConst>;
+    };
+
+    using key_type = std::string;
+    using mapped_type = JsonValue;
+    using value_type = std::pair<std::string, JsonValue>;
+    using size_type = size_t;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+   private:
+    // emplace, for keys that may come from an InternPool
+    std::pair<iterator, bool> emplaceKey(detail::KeyName key, JsonValue value);
+
+   public:
+
+    JsonObject() = default;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const;
+    void clear();
+    void reserve(size_t count);
+
+    iterator begin();
+    iterator end();
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+    [[nodiscard]] const_iterator cbegin() const;
+    [[nodiscard]] const_iterator cend() const;
+
+    // lookups take string_views, so looking up a literal doesn't allocate
+    iterator find(std::string_view key);
+    [[nodiscard]] const_iterator find(std::string_view key) const;
+    [[nodiscard]] size_t count(std::string_view key) const;
+    [[nodiscard]] bool contains(std::string_view key) const;
+
+    // same as find, for when hashKey(key) has already been worked out
+    iterator find(std::string_view key, size_t hash);
+    [[nodiscard]] const_iterator find(std::string_view key, size_t hash) const;
+
+    // !!throws std::out_of_range if the key doesn't exist!!
+    JsonValue& at(std::string_view key);
+    [[nodiscard]] const JsonValue& at(std::string_view key) const;
+
+    // inserts a null member at the end if the key doesn't exist yet
+    JsonValue& operator[](const std::string& key);
+    JsonValue& operator[](std::string&& key);
+
+    // these don't overwrite existing members, same as std::map
+    std::pair<iterator, bool> insert(value_type member);
+    std::pair<iterator, bool> emplace(std::string key, JsonValue value);
+    std::pair<iterator, bool> insert_or_assign(std::string key,
+                                               JsonValue value);
+
+    // removing members keeps the order of the rest
+    size_t erase(std::string_view key);
+    iterator erase(const_iterator pos);
+};
+
+// a JSON Pointer (RFC 6901) like "/courses/0/title", compiled once so it can
+// be evaluated over and over cheaply: the path is split up front, escapes are
+// resolved, key hashes worked out, and segments that look like array indices
+// parsed. evaluate it with JsonValue::find.
+class Pointer
+{
+   public:
+    struct Segment
+    {
+        std::string key;
+        size_t hash;
+        // set if key is a valid array index
+        std::optional<size_t> index;
+    };
+
+   private:
+    std::vector<Segment> segmentList;
+
+   public:
+    // !!throws std::invalid_argument if path isn't a valid JSON Pointer!!
+    explicit Pointer(std::string_view path);
+
+    [[nodiscard]] const std::vector<Segment>& segments() const;
+};
+
+// a pool of short strings for the parser to share between values and object
+// keys: with a pool, each distinct short string (up to maxLength bytes) is
+// allocated once and every value or key holding it points at that one copy.
+// so equal pooled strings also compare equal by address
+// (&a.asString() == &b.asString() on const values). the pool stops taking
+// new strings once it holds maxStrings of them.
+//
+// it also remembers which keys the objects of the last parse had (see
+// detail::ObjectKeys), so that objects in the next parse share those. that
+// way a stream of NDJSON records keeps one copy of its keys in total.
+//
+// a thread safe pool can be shared by parsers on several threads. lookups
+// only take a shared lock, adding a string takes an exclusive one.
+class InternPool
+{
+    std::unordered_map<std::string_view, InternedString> strings;
+    std::vector<detail::SharedKeys> shapeHints;
+    size_t maxStringCount;
+    size_t maxStringLength;
+    bool threadSafe;
+    mutable std::shared_mutex mutex;
+
+    friend class Parser;
+
+   public:
+    explicit InternPool(size_t maxStrings = 65536, size_t maxLength = 32,
+                        bool threadSafe = false);
+
+    // the pooled copy of str, added to the pool if need be. nullptr if str is
+    // longer than maxLength or the pool is full and doesn't have it already.
+    InternedString intern(std::string_view str);
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t maxLength() const;
+};
+
+// an array or object kept as its source text instead of being parsed, see
+// ParseOptions::rawDepth. it either owns a copy of the text or borrows it,
+// in which case whatever the text lives in has to outlive it.
+class RawJson
+{
+    // the text, and what it parses to once something has looked inside.
+    // copies share it.
+    struct State;
+    std::shared_ptr<State> state;
+
+    RawJson() = default;
+    // parses the text the first time it's called, from whichever thread.
+    // !!throws ParsingError if the text isn't valid JSON!!
+    [[nodiscard]] const JsonValue& parsed() const;
+
+    friend class JsonValue;
+
+   public:
+    // takes text as is, it isn't checked until it's parsed (the parser
+    // checks the raw values it makes while it skips them)
+    explicit RawJson(std::string text);
+    static RawJson borrow(std::string_view text);
+
+    [[nodiscard]] std::string_view text() const;
+    [[nodiscard]] bool borrowed() const;
+};
+
+class Projection;
+
+// knobs for parse. the defaults give a plain parse.
+struct ParseOptions
+{
+    // share short strings and keys through this pool. it has to outlive the
+    // parse, but not the values parsed with it.
+    InternPool* internPool = nullptr;
+    // do a quick pass over the source first to count how many elements or
+    // members every array and object has, so each can be allocated at its
+    // final size straight away instead of growing. pays off on big
+    // documents with big arrays, costs a little on small ones.
+    bool precount = false;
+    // arrays and objects nested at least this deep (inside that many others)
+    // are only lexed and checked to be valid, without building or
+    // unescaping anything, and kept as RawJson until something looks inside
+    // them. 0 means parse everything.
+    // good for passing big parts of a document through untouched.
+    size_t rawDepth = 0;
+    // the same for the arrays and objects at these paths (whatever's below
+    // them too). it has to outlive the parse.
+    const Projection* rawPaths = nullptr;
+    // raw values point into the source instead of copying it, so the source
+    // has to outlive them (and anything they turn into, strings aside)
+    bool borrowRaw = false;
+};
+
+enum class ErrorCode : uint8_t {
+    None,
+    UnexpectedCharacter,
+    UnterminatedString,
+    ExpectedValue,
+    ExpectedKey,
+    ExpectedColon,
+    ExpectedObjectStart,
+    ExpectedObjectEnd,
+    ExpectedCommaOrBrace,
+    ExpectedArrayStart,
+    ExpectedArrayEnd,
+    ExpectedCommaOrBracket,
+    InvalidNumber,
+    InvalidCharactersInNumber,
+    NumberOutOfRange,
+    InvalidEscape,
+    InvalidUtf8,
+    TrailingContent,
+    // a value that doesn't fit what it's being read into (see bind.h)
+    WrongType
+};
+
+// what went wrong and where. cheap to make and copy, the message is only
+// put together if someone asks for it.
+struct ParseError
+{
+    ErrorCode code = ErrorCode::None;
+    // bytes from the start of the source
+    size_t offset = 0;
+    size_t line = 0;
+    size_t col = 0;
+
+    // e.g. "Expected ':' after object key."
+    [[nodiscard]] const char* description() const;
+    // the description and where, same as ParsingError::what()
+    [[nodiscard]] std::string message() const;
+};
 
 class ParsingError : public std::runtime_error
 {
-    size_t lineNum;
-    size_t colNum;
+    ParseError details;
 
    public:
     ParsingError(const std::string& message, size_t line, size_t col);
+    explicit ParsingError(const ParseError& error);
 
     [[nodiscard]] size_t line() const;
     [[nodiscard]] size_t col() const;
+    [[nodiscard]] size_t offset() const;
+    [[nodiscard]] ErrorCode code() const;
+};
+
+// a T, or the ParseError saying why there isn't one. a cut down
+// std::expected<T, ParseError>.
+template <typename T>
+class Result
+{
+    std::variant<T, ParseError> contents;
+
+   public:
+    Result(T value) : contents(std::in_place_index<0>, std::move(value)) {}
+    Result(const ParseError& error) : contents(std::in_place_index<1>, error)
+    {
+    }
+
+    [[nodiscard]] bool has_value() const { return contents.index() == 0; }
+    explicit operator bool() const { return has_value(); }
+
+    // !!throws ParsingError if there's no value!!
+    T& value() &
+    {
+        if (!has_value()) {
+            detail::raise(ParsingError(error()));
+        }
+        return *std::get_if<0>(&contents);
+    }
+    [[nodiscard]] const T& value() const&
+    {
+        if (!has_value()) {
+            detail::raise(ParsingError(error()));
+        }
+        return *std::get_if<0>(&contents);
+    }
+    T&& value() && { return std::move(value()); }
+
+    // unchecked, only use these after checking has_value()
+    T& operator*() { return *std::get_if<0>(&contents); }
+    const T& operator*() const { return *std::get_if<0>(&contents); }
+    T* operator->() { return std::get_if<0>(&contents); }
+    const T* operator->() const { return std::get_if<0>(&contents); }
+
+    // only valid when there's no value
+    [[nodiscard]] const ParseError& error() const
+    {
+        return *std::get_if<1>(&contents);
+    }
 };
 
 // variant-based class to hold any valid JSON type.
 class JsonValue
 {
     // underlying variant that holds one of the possible JSON types.
-    std::variant<std::nullptr_t, bool, double, std::string, JsonArray,
-                 JsonObject>
+    // strings from an InternPool are held as InternedStrings, which the
+    // non-const asString() turns into a plain std::string before handing out
+    // a reference that can modify it. asStringView() reads them as they are.
+    //
+    // arrays the parser found to hold only numbers are stored packed (8
+    // bytes an element rather than a whole JsonValue). the non-const
+    // asArray() turns those into a regular JsonArray. the const accessors
+    // leave them packed: asNumberSpan() reads the numbers as they are, and
+    // the const asArray() and find() go through a JsonArray copy made the
+    // first time one of them needs it. so reading a value never modifies it
+    // and is safe from several threads.
+    //
+    // RawJson is parsed by the first accessor that needs to look inside it
+    // (see materialize()). the is*() checks peek at its first character
+    // instead.
+    //
+    // no_unique_address lets versionStamp go in the variant's tail padding,
+    // so it doesn't make values any bigger.
+    [[no_unique_address]] std::variant<
+      std::nullptr_t, bool, double, std::string, InternedString, JsonArray,
+      detail::PackedArray, JsonObject, RawJson>
       value;
 
+    // bumped by every non-const accessor. Document keeps its source spans
+    // to the side and checks this to tell if they still apply.
+    detail::VersionStamp versionStamp;
+
+    // first character of a raw value, 0 for anything else
+    [[nodiscard]] char rawStart() const;
+
+    friend class Parser;
+    // reads the variant directly in its inner loops
+    friend class Query;
+    friend class Index;
+
    public:
     // Constructors for each JSON type
     JsonValue(std::nullptr_t = nullptr);
@@ -50,8 +643,10 @@ class JsonValue
     JsonValue(const char* s);
     JsonValue(const JsonArray& a);
     JsonValue(JsonArray&& a);
+    JsonValue(NumberArray&& a);
     JsonValue(const JsonObject& o);
     JsonValue(JsonObject&& o);
+    JsonValue(RawJson&& r);
 
     // Helper functions to check the contained type
     [[nodiscard]] bool isNull() const;
@@ -60,8 +655,30 @@ class JsonValue
     [[nodiscard]] bool isString() const;
     [[nodiscard]] bool isArray() const;
     [[nodiscard]] bool isObject() const;
+    // an array that's (still) stored packed, see asNumberSpan
+    [[nodiscard]] bool isNumberArray() const;
+    // not parsed yet, see RawJson
+    [[nodiscard]] bool isRaw() const;
+
+    // parses a raw value in place, a no-op for anything else. the accessors
+    // below do this themselves.
+    //
+    // the const version leaves the value as it is and returns what its text
+    // parses to instead (*this if it isn't raw). the text is parsed once and
+    // kept with it (and its copies), and that's safe to do from several
+    // threads at once.
+    //
+    // raw values from the parser were checked while it skipped them, so it's
+    // only text given to RawJson's constructor that can fail.
+    // !!throws ParsingError if the raw text isn't valid JSON, with positions
+    // within that text!!
+    JsonValue& materialize();
+    const JsonValue& materialize() const;
 
-    // type-safe accessors. !!throws std::bad_variant_access on type mismatch!!
+    // type-safe accessors. they materialize() raw values first, so they
+    // throw what that does too. on a packed array the const asArray() reads
+    // the copy described above (asNumberSpan() is cheaper where it'll do).
+    // !!throws std::bad_variant_access on type mismatch!!
     bool& asBool();
     double& asNumber();
     std::string& asString();
@@ -74,13 +691,309 @@ class JsonValue
     [[nodiscard]] const JsonArray& asArray() const;
     [[nodiscard]] const JsonObject& asObject() const;
 
+    // the string, without the non-const asString() making a pooled one a
+    // copy of its own first (which it has to, the copy could be modified).
+    // !!throws std::bad_variant_access if it isn't a string!!
+    [[nodiscard]] std::string_view asStringView() const;
+
+    // the numbers of a packed array, without copying them. only valid until
+    // the array is touched through the non-const asArray(). writing through
+    // the non-const span is fine, it drops the const asArray()'s copy.
+    // !!throws std::bad_variant_access if isNumberArray() is false!!
+    std::span<double> asNumberSpan();
+    [[nodiscard]] std::span<const double> asNumberSpan() const;
+    // !!throws std::bad_variant_access if isRaw() is false!!
+    [[nodiscard]] const RawJson& asRaw() const;
+
+    // lookups that don't throw (other than materialize()'s ParsingError on
+    // a hand made RawJson). nullptr if there's no such value (or a value
+    // along the way has the wrong type).
+    [[nodiscard]] const JsonValue* find(std::string_view key) const;
+    [[nodiscard]] const JsonValue* find(const Pointer& pointer) const;
+    JsonValue* find(std::string_view key);
+    JsonValue* find(const Pointer& pointer);
+
+    // changes whenever a non-const accessor is called on this value (or it's
+    // assigned to, or a DocumentParser parses into it). like with Document,
+    // reaching anything nested mutably goes through its parents' non-const
+    // accessors, so modifying an element changes the version of the array
+    // holding it as well. it doesn't notice modifications through references
+    // taken before the version was read. wraps around after 2^31 changes.
+    // moving a value keeps its version, see VersionStamp.
+    [[nodiscard]] uint32_t version() const;
+
     friend void serialise(const JsonValue& val, std::ostream& os, int indent);
+    friend void serialiseParallel(const JsonValue& val, std::ostream& os,
+                                  int indent, unsigned threads);
+    friend void serialiseCompact(const JsonValue& val, std::ostream& os,
+                                 const Document* document);
+};
+
+// a parsed JSON document that holds on to its source text. values that are
+// only ever read (or not touched at all) remember their original bytes, so
+// serialising the document copies those bytes straight through instead of
+// formatting them again. numbers and strings keep their exact lexemes.
+//
+// a value counts as modified as soon as a non-const accessor is called on it.
+// since reaching any nested value mutably goes through the non-const
+// accessors of all its parents, modifying something deep in the tree only
+// marks the path down to it as modified. everything else stays clean.
+//
+// values containing comments are never copied through, so the output is
+// always plain JSON.
+//
+// the spans are kept here rather than in the values. every value with a
+// span gets a version() of its own from a range the document took, and
+// that version minus the start of the range is where its span is. moving a
+// value (which adding members or elements next to it can do) keeps its
+// version, so it keeps its span too. modifying or copying it doesn't.
+class Document
+{
+    // behind pointers so the spans (and the values they're for) survive
+    // moving the document
+    std::unique_ptr<const std::string> text;
+    std::unique_ptr<JsonValue> rootValue;
+    std::vector<std::string_view> spans;
+    uint32_t firstStamp = 0;
+
+    Document();
+
+   public:
+    // !!throws ParsingError on invalid input!!
+    explicit Document(std::string source, const ParseOptions& options = {});
+
+    // same, without the throwing
+    [[nodiscard]] static Result<Document>
+    tryParse(std::string source, const ParseOptions& options = {});
+
+    JsonValue& root();
+    [[nodiscard]] const JsonValue& root() const;
+
+    [[nodiscard]] std::string_view source() const;
+    // the exact source bytes value was parsed from, if it's in this document
+    // and hasn't been touched through a non-const accessor since. empty if
+    // not.
+    [[nodiscard]] std::string_view source(const JsonValue& value) const;
+
+    [[nodiscard]] const JsonValue* find(const Pointer& pointer) const;
+    JsonValue* find(const Pointer& pointer);
+
+    // compact serialisation, see serialiseCompact
+    void serialise(std::ostream& os) const;
+};
+
+class PaddedView;
+
+// a copy of some text followed by padding zero bytes. the lexer can then read
+// ahead (eight bytes at a time in strings) without checking for the end of
+// the input on every byte.
+class PaddedString
+{
+    std::unique_ptr<char[]> buffer;
+    size_t length = 0;
+
+   public:
+    static constexpr size_t padding = 64;
+
+    PaddedString() = default;
+    explicit PaddedString(std::string_view text);
+    PaddedString(const PaddedString& other);
+    PaddedString(PaddedString&& other) noexcept = default;
+    PaddedString& operator=(const PaddedString& other);
+    PaddedString& operator=(PaddedString&& other) noexcept = default;
+
+    [[nodiscard]] std::string_view view() const;
+    [[nodiscard]] size_t size() const;
+
+    operator PaddedView() const;
+};
+
+// text that's followed by (at least) PaddedString::padding zero bytes,
+// without owning or copying it
+class PaddedView
+{
+    std::string_view text;
+
+    explicit PaddedView(std::string_view text);
+
+    friend class PaddedString;
+
+   public:
+    // the first length bytes of buffer are the text. capacity is how big
+    // buffer really is, and the padding after the text gets zeroed here.
+    // !!throws std::invalid_argument if capacity < length + padding!!
+    PaddedView(char* buffer, size_t length, size_t capacity);
+
+    [[nodiscard]] std::string_view view() const;
+};
+
+class Parser;
+
+// parses one document after another into the same tree, reusing its memory.
+// when consecutive documents have the same structure (say, requests to the
+// same endpoint) strings, arrays and objects are written over in place, and
+// once a few have been through parsing doesn't allocate at all. the parser's
+// own buffers are kept too. not thread safe, keep one per thread.
+class DocumentParser
+{
+    std::unique_ptr<Parser> parser;
+    JsonValue rootValue;
+
+    Result<JsonValue*> parseRoot(std::string_view source, bool padded);
+
+   public:
+    explicit DocumentParser(const ParseOptions& options = {});
+    DocumentParser(DocumentParser&& other) noexcept;
+    DocumentParser& operator=(DocumentParser&& other) noexcept;
+    ~DocumentParser();
+
+    // parses source into root(), replacing the last document.
+    // !!throws ParsingError on invalid input, root() is null after that!!
+    JsonValue& parse(std::string_view source);
+    // same, without the throwing
+    [[nodiscard]] Result<JsonValue*> tryParse(std::string_view source);
+
+    JsonValue& parse(PaddedView source);
+    [[nodiscard]] Result<JsonValue*> tryParse(PaddedView source);
+
+    JsonValue& root();
+    [[nodiscard]] const JsonValue& root() const;
+};
+
+// the JSON values in a buffer one after another: newline delimited JSON,
+// RFC 7464 JSON text sequences (the 0x1E record separators are skipped), or
+// just values back to back. the lexer carries on from where the last value
+// ended, so the buffer is scanned once and nothing is copied.
+//
+//   for (json::JsonValue& value : json::DocumentStream(buffer)) { ... }
+class DocumentStream
+{
+    std::unique_ptr<Parser> parser;
+    JsonValue currentValue;
+
+   public:
+    class iterator
+    {
+        // nullptr once we're past the last value
+        DocumentStream* stream;
+
+       public:
+        using value_type = JsonValue;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        explicit iterator(DocumentStream* stream = nullptr);
+
+        JsonValue& operator*() const;
+        JsonValue* operator->() const;
+        // !!throws ParsingError on invalid input!!
+        iterator& operator++();
+        void operator++(int);
+        bool operator==(std::default_sentinel_t) const;
+    };
+
+    explicit DocumentStream(std::string_view source,
+                            const ParseOptions& options = {});
+    DocumentStream(DocumentStream&& other) noexcept;
+    DocumentStream& operator=(DocumentStream&& other) noexcept;
+    ~DocumentStream();
+
+    // the next value, nullptr after the last one. it's only valid until the
+    // next call, which parses over it.
+    // !!throws ParsingError on invalid input!!
+    JsonValue* next();
+    // same, without the throwing
+    [[nodiscard]] Result<JsonValue*> tryNext();
+
+    // bytes from the start of the buffer to the end of the last value
+    [[nodiscard]] size_t consumed() const;
+
+    // !!throws ParsingError on invalid input!!
+    iterator begin();
+    std::default_sentinel_t end();
 };
 
 [[nodiscard]] JsonValue parse(std::string_view source);
+[[nodiscard]] JsonValue parse(std::string_view source,
+                              const ParseOptions& options);
+// same, but quicker: see PaddedString
+[[nodiscard]] JsonValue parse(PaddedView source,
+                              const ParseOptions& options = {});
+
+struct PrefixResult
+{
+    JsonValue value;
+    // bytes from the start of the source to the end of value
+    size_t consumed;
+};
+
+// parses the value at the start of source and stops right after it, leaving
+// whatever comes next alone (parse would call that an error)
+// !!throws ParsingError on invalid input!!
+[[nodiscard]] PrefixResult parsePrefix(std::string_view source,
+                                       const ParseOptions& options = {});
+[[nodiscard]] Result<PrefixResult>
+tryParsePrefix(std::string_view source, const ParseOptions& options = {});
+
+// like parse, but failures come back in the Result instead of being thrown,
+// and nothing is thrown or caught on the way (so also works when built with
+// -fno-exceptions)
+[[nodiscard]] Result<JsonValue> tryParse(std::string_view source);
+[[nodiscard]] Result<JsonValue> tryParse(std::string_view source,
+                                         const ParseOptions& options);
+[[nodiscard]] Result<JsonValue> tryParse(PaddedView source,
+                                         const ParseOptions& options = {});
+
+// the parts of a document to keep, as JSON Pointers where a * segment
+// matches every member of an object or element of an array:
+//
+//   json::parse(source, {"/user/id", "/items/*/price"})
+//
+// gives {"user": {"id": ...}, "items": [{"price": ...}, ...]} and nothing
+// else. objects and arrays only keep the members and elements that had
+// something matching in them (so array indices can shift), and if nothing
+// matches at all the result is null.
+class Projection
+{
+   public:
+    struct Node;
+
+   private:
+    std::shared_ptr<const Node> root;
+
+   public:
+    // !!throws std::invalid_argument if a path isn't a valid JSON Pointer!!
+    Projection(std::initializer_list<std::string_view> paths);
+    explicit Projection(const std::vector<std::string>& paths);
+
+    [[nodiscard]] const Node& tree() const;
+};
+
+// parses only what's on projection's paths. everything else is skipped
+// over without building or even unescaping it, and only checked for
+// balanced brackets (each closing the kind it opened) and closed strings and
+// comments.
+// !!throws ParsingError on invalid input!!
+[[nodiscard]] JsonValue parse(std::string_view source,
+                              const Projection& projection);
+[[nodiscard]] Result<JsonValue> tryParse(std::string_view source,
+                                         const Projection& projection);
 
 void serialise(const JsonValue& val, std::ostream& os, int indent = 0);
 
+// same output as serialise (byte for byte), but arrays and objects with lots
+// of elements are split into chunks that get serialised on separate threads
+// and then written out in order. threads == 0 means use every core.
+void serialiseParallel(const JsonValue& val, std::ostream& os, int indent = 0,
+                       unsigned threads = 0);
+
+// serialises without any whitespace, escaping strings and writing numbers
+// with as many digits as it takes to read them back exactly.
+// values of document that it still has the source of are written out as
+// those bytes verbatim (see Document).
+void serialiseCompact(const JsonValue& val, std::ostream& os,
+                      const Document* document = nullptr);
+
 std::ostream& operator<<(std::ostream& os, const JsonValue& val);
 
 } // namespace json
@@ -0,0 +1,570 @@
+#pragma once
+
+#include "json.h"
+#include "scalars.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// JSON parsed at compile time:
+//
+//   using namespace json::literals;
+//   static constexpr auto config = R"({"port": 8080})"_json;
+//   static_assert(config.root().find("port")->asNumber() == 8080);
+//
+// the literal is checked while compiling (invalid JSON doesn't compile) and
+// ends up as read-only arrays in the binary, so there's nothing left to parse
+// at startup. same grammar as json::parse, comments included.
+
+namespace json
+{
+
+enum class StaticType : uint8_t { Null, Bool, Number, String, Array, Object };
+
+namespace detail
+{
+
+struct StaticNode
+{
+    StaticType type = StaticType::Null;
+    bool boolean = false;
+    // strings: length. arrays: elements. objects: members.
+    uint32_t size = 0;
+    // strings: where the characters start in the document's chars.
+    // arrays and objects: index of the first node after their last child.
+    uint32_t offset = 0;
+    // arrays and objects: where their children's node indices start in the
+    // document's children
+    uint32_t first = 0;
+    double number = 0;
+};
+
+// not constexpr, so reaching it while compiling is a compile error, and the
+// error message shows why
+inline void invalidJsonLiteral(const char* why)
+{
+    raise(std::invalid_argument(why));
+}
+
+// a string literal as a template argument
+template <size_t N>
+struct FixedString
+{
+    char chars[N] = {};
+
+    constexpr FixedString(const char (&s)[N])
+    {
+        for (size_t i = 0; i < N; ++i) {
+            chars[i] = s[i];
+        }
+    }
+    [[nodiscard]] constexpr std::string_view view() const
+    {
+        return {chars, N - 1};
+    }
+};
+
+// just counts what the parser would write, for sizing the arrays
+struct StaticCounter
+{
+    size_t nodes = 0;
+    size_t chars = 0;
+    size_t children = 0;
+
+    constexpr size_t addNode(const StaticNode&) { return nodes++; }
+    constexpr void setNode(size_t, const StaticNode& node)
+    {
+        children += node.size;
+    }
+    constexpr void addChar(char) { chars++; }
+    [[nodiscard]] constexpr size_t charCount() const { return chars; }
+};
+
+template <typename Document>
+struct StaticWriter
+{
+    Document& document;
+    size_t nodes = 0;
+    size_t chars = 0;
+
+    constexpr size_t addNode(const StaticNode& node)
+    {
+        document.nodes[nodes] = node;
+        return nodes++;
+    }
+    constexpr void setNode(size_t index, const StaticNode& node)
+    {
+        document.nodes[index] = node;
+    }
+    constexpr void addChar(char c) { document.chars[chars++] = c; }
+    [[nodiscard]] constexpr size_t charCount() const { return chars; }
+};
+
+// a constexpr lexer and parser in one, writing nodes in pre-order: a
+// container, then its children (an object's keys and values taking turns)
+template <typename Output>
+class StaticParser
+{
+    std::string_view source;
+    size_t pos = 0;
+    Output& out;
+
+    [[nodiscard]] constexpr char peek(size_t ahead = 0) const
+    {
+        return pos + ahead < source.size() ? source[pos + ahead] : '\0';
+    }
+    constexpr void expect(char c, const char* why)
+    {
+        skipWhitespaceAndComments();
+        if (peek() != c) {
+            invalidJsonLiteral(why);
+        }
+        pos++;
+    }
+    constexpr void skipWhitespaceAndComments()
+    {
+        while (pos < source.size()) {
+            char c = peek();
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                pos++;
+            } else if (c == '/' && peek(1) == '/') {
+                while (pos < source.size() && peek() != '\n') {
+                    pos++;
+                }
+            } else if (c == '/' && peek(1) == '*') {
+                pos += 2;
+                while (pos < source.size() && (peek() != '*' || peek(1) != '/'))
+                {
+                    pos++;
+                }
+                pos += 2;
+            } else {
+                return;
+            }
+        }
+    }
+
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // checked and decoded by the same routines as json::parse's strings
+    constexpr void parseString()
+    {
+        expect('"', "Expected a string.");
+        size_t start = out.charCount();
+        auto add = [this](char c) { out.addChar(c); };
+        while (peek() != '"') {
+            if (pos >= source.size()) {
+                invalidJsonLiteral("Unterminated string.");
+            }
+            char c = peek();
+            if ((static_cast<uint8_t>(c) & 0x80) != 0) {
+                size_t length = utf8SequenceLength(source.data() + pos,
+                                                   source.size() - pos);
+                if (length == 0) {
+                    invalidJsonLiteral("String is not valid UTF-8.");
+                }
+                for (size_t i = 0; i < length; ++i) {
+                    add(source[pos++]);
+                }
+                continue;
+            }
+            pos++;
+            if (c != '\\') {
+                add(c);
+                continue;
+            }
+            char escaped = peek();
+            pos++;
+            switch (escaped) {
+                case '"':
+                case '\\':
+                case '/': add(escaped); break;
+                case 'b': add('\b'); break;
+                case 'f': add('\f'); break;
+                case 'n': add('\n'); break;
+                case 'r': add('\r'); break;
+                case 't': add('\t'); break;
+                case 'u': {
+                    size_t end = decodeUnicodeEscape(source, pos, add);
+                    if (end == pos) {
+                        invalidJsonLiteral(
+                          "Invalid escape sequence in string.");
+                    }
+                    pos = end;
+                    break;
+                }
+                default:
+                    invalidJsonLiteral("Invalid escape sequence in string.");
+            }
+        }
+        pos++; // closing quote
+        out.addNode({.type = StaticType::String,
+                     .size = static_cast<uint32_t>(out.charCount() - start),
+                     .offset = static_cast<uint32_t>(start)});
+    }
+
+    // takes the same characters the runtime lexer does for a number, and
+    // converts them with the same detail::parseNumber, so the result is the
+    // same double json::parse gives, to the bit
+    constexpr double parseNumber()
+    {
+        size_t start = pos;
+        if (peek() == '-') {
+            pos++;
+        }
+        while (isDigit(peek())) {
+            pos++;
+        }
+        if (peek() == '.' && isDigit(peek(1))) {
+            pos++;
+            while (isDigit(peek())) {
+                pos++;
+            }
+        }
+        if (peek() == 'e' || peek() == 'E') {
+            pos++;
+            if (peek() == '+' || peek() == '-') {
+                pos++;
+            }
+            while (isDigit(peek())) {
+                pos++;
+            }
+        }
+        double value = 0;
+        switch (detail::parseNumber(source.substr(start, pos - start), value)) {
+            case ErrorCode::None: break;
+            case ErrorCode::NumberOutOfRange:
+                invalidJsonLiteral("Number is out of range for a double.");
+                break;
+            case ErrorCode::InvalidCharactersInNumber:
+                invalidJsonLiteral("Invalid characters in number literal.");
+                break;
+            default: invalidJsonLiteral("Invalid number format.");
+        }
+        return value;
+    }
+
+    constexpr void parseArray()
+    {
+        size_t index = out.addNode({.type = StaticType::Array});
+        expect('[', "Expected '[' to start an array.");
+        uint32_t count = 0;
+        skipWhitespaceAndComments();
+        if (peek() != ']') {
+            while (true) {
+                parseValue();
+                count++;
+                skipWhitespaceAndComments();
+                if (peek() == ']') {
+                    break;
+                }
+                expect(',', "Expected ',' or ']' after array element.");
+            }
+        }
+        pos++;
+        out.setNode(index, {.type = StaticType::Array,
+                            .size = count,
+                            .offset = static_cast<uint32_t>(nodeCount())});
+    }
+
+    constexpr void parseObject()
+    {
+        size_t index = out.addNode({.type = StaticType::Object});
+        expect('{', "Expected '{' to start an object.");
+        uint32_t count = 0;
+        skipWhitespaceAndComments();
+        if (peek() != '}') {
+            while (true) {
+                skipWhitespaceAndComments();
+                if (peek() != '"') {
+                    invalidJsonLiteral(
+                      "Expected a string key for object member.");
+                }
+                parseString();
+                expect(':', "Expected ':' after object key.");
+                parseValue();
+                count++;
+                skipWhitespaceAndComments();
+                if (peek() == '}') {
+                    break;
+                }
+                expect(',', "Expected ',' or '}' after object member.");
+            }
+        }
+        pos++;
+        out.setNode(index, {.type = StaticType::Object,
+                            .size = count,
+                            .offset = static_cast<uint32_t>(nodeCount())});
+    }
+
+    [[nodiscard]] constexpr size_t nodeCount() const { return out.nodes; }
+
+    constexpr bool literal(std::string_view word)
+    {
+        if (source.substr(pos, word.size()) != word) {
+            return false;
+        }
+        pos += word.size();
+        return true;
+    }
+
+   public:
+    constexpr StaticParser(std::string_view source, Output& out)
+      : source(source), out(out)
+    {
+    }
+
+    constexpr void parseValue()
+    {
+        skipWhitespaceAndComments();
+        char c = peek();
+        if (c == '{') {
+            parseObject();
+        } else if (c == '[') {
+            parseArray();
+        } else if (c == '"') {
+            parseString();
+        } else if (c == '-' || isDigit(c)) {
+            out.addNode({.type = StaticType::Number, .number = parseNumber()});
+        } else if (literal("true")) {
+            out.addNode({.type = StaticType::Bool, .boolean = true});
+        } else if (literal("false")) {
+            out.addNode({.type = StaticType::Bool, .boolean = false});
+        } else if (literal("null")) {
+            out.addNode({.type = StaticType::Null});
+        } else {
+            invalidJsonLiteral("Expected a value (object, array, string, "
+                               "number, true, false, or null).");
+        }
+    }
+
+    constexpr void parseRoot()
+    {
+        parseValue();
+        skipWhitespaceAndComments();
+        if (pos < source.size()) {
+            invalidJsonLiteral("Unexpected content after the JSON value.");
+        }
+    }
+};
+
+// lists every array's and object's children (an object's values, its keys
+// are just before them) in document.children, so they can be found without
+// going through their older siblings
+template <typename Document>
+constexpr void indexChildren(Document& document)
+{
+    uint32_t filled = 0;
+    for (uint32_t i = 0; i < document.nodes.size(); ++i) {
+        StaticNode& node = document.nodes[i];
+        if (node.type != StaticType::Array && node.type != StaticType::Object) {
+            continue;
+        }
+        node.first = filled;
+        uint32_t child = i + 1;
+        for (uint32_t n = 0; n < node.size; ++n) {
+            if (node.type == StaticType::Object) {
+                child++; // the key
+            }
+            document.children[filled++] = child;
+            const StaticNode& childNode = document.nodes[child];
+            child = childNode.type == StaticType::Array ||
+                        childNode.type == StaticType::Object
+                      ? childNode.offset
+                      : child + 1;
+        }
+    }
+}
+
+} // namespace detail
+
+// a read-only view of one value in a StaticDocument
+class StaticValue
+{
+    const detail::StaticNode* nodes;
+    const char* chars;
+    const uint32_t* children;
+    uint32_t index;
+
+    [[nodiscard]] constexpr const detail::StaticNode& node() const
+    {
+        return nodes[index];
+    }
+    [[nodiscard]] constexpr StaticValue at(uint32_t i) const
+    {
+        return {nodes, chars, children, i};
+    }
+    // the node index of the i-th element, or of the value of the i-th member
+    [[nodiscard]] constexpr uint32_t child(size_t i) const
+    {
+        return children[node().first + i];
+    }
+
+   public:
+    constexpr StaticValue(const detail::StaticNode* nodes, const char* chars,
+                          const uint32_t* children, uint32_t index)
+      : nodes(nodes), chars(chars), children(children), index(index)
+    {
+    }
+
+    [[nodiscard]] constexpr StaticType type() const { return node().type; }
+    [[nodiscard]] constexpr bool isNull() const
+    {
+        return type() == StaticType::Null;
+    }
+    [[nodiscard]] constexpr bool isBool() const
+    {
+        return type() == StaticType::Bool;
+    }
+    [[nodiscard]] constexpr bool isNumber() const
+    {
+        return type() == StaticType::Number;
+    }
+    [[nodiscard]] constexpr bool isString() const
+    {
+        return type() == StaticType::String;
+    }
+    [[nodiscard]] constexpr bool isArray() const
+    {
+        return type() == StaticType::Array;
+    }
+    [[nodiscard]] constexpr bool isObject() const
+    {
+        return type() == StaticType::Object;
+    }
+
+    // !!throws std::bad_variant_access on type mismatch!!
+    [[nodiscard]] constexpr bool asBool() const
+    {
+        if (!isBool()) {
+            detail::raise(std::bad_variant_access());
+        }
+        return node().boolean;
+    }
+    [[nodiscard]] constexpr double asNumber() const
+    {
+        if (!isNumber()) {
+            detail::raise(std::bad_variant_access());
+        }
+        return node().number;
+    }
+    [[nodiscard]] constexpr std::string_view asString() const
+    {
+        if (!isString()) {
+            detail::raise(std::bad_variant_access());
+        }
+        return {chars + node().offset, node().size};
+    }
+
+    // elements of an array or members of an object, 0 for anything else
+    [[nodiscard]] constexpr size_t size() const
+    {
+        return isArray() || isObject() ? node().size : 0;
+    }
+    // the i-th element of an array, or the value of an object's i-th member
+    // !!throws std::out_of_range if there isn't one!!
+    [[nodiscard]] constexpr StaticValue operator[](size_t i) const
+    {
+        if (i >= size()) {
+            detail::raise(std::out_of_range("StaticValue: no such element"));
+        }
+        return at(child(i));
+    }
+    // the key of an object's i-th member
+    // !!throws std::out_of_range if there isn't one!!
+    [[nodiscard]] constexpr std::string_view keyAt(size_t i) const
+    {
+        if (!isObject() || i >= size()) {
+            detail::raise(std::out_of_range("StaticValue: no such member"));
+        }
+        return at(child(i) - 1).asString();
+    }
+
+    // member lookup, nullopt if this isn't an object or the key is missing.
+    // later duplicates win, same as json::parse.
+    [[nodiscard]] constexpr std::optional<StaticValue>
+    find(std::string_view key) const
+    {
+        if (!isObject()) {
+            return std::nullopt;
+        }
+        for (size_t i = size(); i-- > 0;) {
+            if (at(child(i) - 1).asString() == key) {
+                return at(child(i));
+            }
+        }
+        return std::nullopt;
+    }
+
+    // a regular (mutable) copy
+    [[nodiscard]] JsonValue toJsonValue() const
+    {
+        switch (type()) {
+            case StaticType::Null: return {nullptr};
+            case StaticType::Bool: return {asBool()};
+            case StaticType::Number: return {asNumber()};
+            case StaticType::String: return {std::string(asString())};
+            case StaticType::Array: {
+                JsonArray array;
+                array.reserve(size());
+                for (size_t i = 0; i < size(); ++i) {
+                    array.push_back((*this)[i].toJsonValue());
+                }
+                return {std::move(array)};
+            }
+            case StaticType::Object: {
+                JsonObject object;
+                object.reserve(size());
+                for (size_t i = 0; i < size(); ++i) {
+                    object.insert_or_assign(std::string(keyAt(i)),
+                                            (*this)[i].toJsonValue());
+                }
+                return {std::move(object)};
+            }
+        }
+        return {nullptr};
+    }
+};
+
+// what _json makes: every value's node in one array, every string's
+// characters in another, and the node indices of every array's and object's
+// children in a third, so indexing is constant time
+template <size_t NodeCount, size_t CharCount, size_t ChildCount>
+struct StaticDocument
+{
+    std::array<detail::StaticNode, NodeCount> nodes{};
+    std::array<char, CharCount> chars{};
+    std::array<uint32_t, ChildCount> children{};
+
+    [[nodiscard]] constexpr StaticValue root() const
+    {
+        return {nodes.data(), chars.data(), children.data(), 0};
+    }
+};
+
+namespace literals
+{
+
+// !!doesn't compile if the literal isn't valid JSON!!
+template <detail::FixedString Source>
+consteval auto operator""_json()
+{
+    constexpr auto sizes = [] {
+        detail::StaticCounter counter;
+        detail::StaticParser(Source.view(), counter).parseRoot();
+        return counter;
+    }();
+
+    StaticDocument<sizes.nodes, sizes.chars, sizes.children> document;
+    detail::StaticWriter writer{document};
+    detail::StaticParser(Source.view(), writer).parseRoot();
+    detail::indexChildren(document);
+    return document;
+}
+
+} // namespace literals
+
+} // namespace json
@@ -1,4 +1,27 @@
+#include "bind.h"
+#include "columns.h"
+#include "index.h"
 #include "json.h"
+#include "literal.h"
+#include "path.h"
+#include "template.h"
+
+#include <sstream>
+
+struct Point
+{
+    double x = 0;
+    double y = 0;
+    std::string label;
+};
+
+template <>
+struct json::Binding<Point>
+{
+    static constexpr auto fields =
+      std::tuple{json::field("x", &Point::x), json::field("y", &Point::y),
+                 json::field("label", &Point::label)};
+};
 
 int main()
 {
@@ -23,7 +46,8 @@ int main()
 
         // Accessing data
         std::cout << "\n--- Accessing data ---" << '\n';
-        std::cout << "Name: " << data.asObject().at("name").asString() << '\n';
+        std::cout << "Name: " << data.asObject().at("name").asStringView()
+                  << '\n';
         double age = data.asObject().at("age").asNumber();
         std::cout << "Age: " << age << '\n';
         std::cout << "First course title: "
@@ -32,9 +56,19 @@ int main()
                        .asArray()[0]
                        .asObject()
                        .at("title")
-                       .asString()
+                       .asStringView()
                   << '\n';
 
+        // or compile a JSON Pointer once and look things up without throwing
+        json::Pointer secondCredits("/courses/1/credits");
+        if (const auto* credits = data.find(secondCredits)) {
+            std::cout << "Second course credits: " << credits->asNumber()
+                      << '\n';
+        }
+        if (data.find(json::Pointer("/courses/7/title")) == nullptr) {
+            std::cout << "There is no eighth course" << '\n';
+        }
+
     } catch (const json::ParsingError& e) {
         std::cerr << "Parsing failed: " << e.what() << '\n';
     }
@@ -72,5 +106,92 @@ int main()
         std::cerr << "Caught expected error: " << e.what() << '\n';
     }
 
+    // Example 5: or don't throw at all
+    auto result = json::tryParse(R"([1, 2, oops])");
+    if (!result) {
+        std::cerr << "Expected error at byte " << result.error().offset << ": "
+                  << result.error().description() << '\n';
+    }
+
+    // Example 6: a stream of values, one after the other
+    for (json::JsonValue& event :
+         json::DocumentStream("{\"id\": 1}\n{\"id\": 2}\n"))
+    {
+        std::cout << "Event " << event.find("id")->asNumber() << '\n';
+    }
+
+    // Example 7: JSON checked and laid out at compile time
+    using namespace json::literals;
+    static constexpr auto defaults =
+      R"({"retries": 3, "hosts": ["a.example", "b.example"]})"_json;
+    static_assert(defaults.root().find("retries")->asNumber() == 3);
+    std::cout << "Default host: "
+              << defaults.root().find("hosts")->operator[](1).asString()
+              << '\n';
+
+    // Example 8: straight into a struct
+    auto points = json::parseInto<std::vector<Point>>(
+      R"([{"x": 1, "y": 2, "label": "a"}, {"x": 3, "y": 4, "z": 5}])");
+    std::cout << "Read " << points.size() << " points, first is "
+              << points[0].label << '\n';
+    std::cout << "And back: " << json::serialiseStruct(points[1]) << '\n';
+
+    // Example 9: the same response over and over
+    json::Template greeting(R"({"greeting": "hello", "to": {{name}}})");
+    std::cout << greeting.render("Ann") << '\n' << greeting.render("Bo") << '\n';
+
+    // Example 10: only the parts you want
+    json::JsonValue prices = json::parse(
+      R"({"shop": "x", "items": [{"name": "a", "price": 1},
+                                 {"name": "b", "price": 2}]})",
+      {"/items/*/price"});
+    std::cout << "Prices: " << prices << '\n';
+
+    // Example 11: passing the payload on without parsing it
+    json::ParseOptions envelope;
+    envelope.rawDepth = 1;
+    json::JsonValue message = json::parse(
+      R"({"to": "billing", "body": {"invoice": 7, "lines": [1, 2]}})",
+      envelope);
+    message.asObject()["to"] = "archive";
+    std::cout << "Forwarding (body raw: " << message.find("body")->isRaw()
+              << "): ";
+    json::serialiseCompact(message, std::cout);
+    std::cout << '\n';
+
+    // Example 12: querying a stream too big to parse
+    std::istringstream log(R"({"records": [{"user": {"email": "ann@example.com"}},
+                                             {"user": {"email": "bo@example.com"}}]})");
+    json::streamQuery(log, json::Path("$.records[*].user.email"),
+                      [](const json::JsonValue& email) {
+                          std::cout << "Email: " << email.asString() << '\n';
+                      });
+
+    // Example 13: filtering a parsed document
+    json::JsonValue stock = json::parse(
+      R"({"items": [{"name": "lamp", "price": 120}, {"name": "mug", "price": 8}]})");
+    json::Query expensive("$.items[?(@.price > 100)].name");
+    for (const json::JsonValue* name : expensive.run(stock)) {
+        std::cout << "Expensive: " << name->asString() << '\n';
+    }
+
+    // Example 14: records as columns
+    auto readings = json::parseColumns(
+      R"([{"ts": 1, "v": 20.5}, {"ts": 2}, {"ts": 3, "v": 21.5}])",
+      {{"/ts", json::ColumnType::Integer}, {"/v", json::ColumnType::Number}});
+    double total = 0;
+    for (size_t row = 0; row < readings[1].rows; ++row) {
+        if (readings[1].valid(row)) {
+            total += readings[1].numbers[row];
+        }
+    }
+    std::cout << "Total: " << total << '\n';
+
+    // Example 15: looking records up by id
+    json::JsonValue users = json::parse(
+      R"([{"id": 17, "name": "ann"}, {"id": 4, "name": "bo"}])");
+    json::Index byId(users, "/id");
+    std::cout << "User 4: " << byId.find(4)->find("name")->asString() << '\n';
+
     return 0;
 }
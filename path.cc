@@ -0,0 +1,1220 @@
+#include "path.h"
+#include "detail.h"
+
+#include <array>
+#include <bit>
+#include <istream>
+
+namespace json
+{
+
+namespace
+{
+
+// reads a JSONPath expression into its steps
+class PathReader
+{
+    std::string_view text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const std::string& problem) const
+    {
+        detail::raise(std::invalid_argument(
+          "JSONPath: " + problem + " at offset " + std::to_string(pos) +
+          " of \"" + std::string(text) + "\""));
+    }
+    [[nodiscard]] char peek() const
+    {
+        return pos < text.size() ? text[pos] : '\0';
+    }
+    bool eat(std::string_view expected)
+    {
+        if (text.substr(pos).starts_with(expected)) {
+            pos += expected.size();
+            return true;
+        }
+        return false;
+    }
+    void expect(char c)
+    {
+        if (!eat(std::string_view(&c, 1))) {
+            fail(std::string("expected '") + c + "'");
+        }
+    }
+    void skipSpaces()
+    {
+        while (peek() == ' ') {
+            ++pos;
+        }
+    }
+
+    std::string name();
+    std::string quoted();
+    int64_t integer();
+    JsonValue literal();
+    Path::Comparison comparison();
+    Path::Step bracket(bool descendant);
+
+   public:
+    explicit PathReader(std::string_view text) : text(text) {}
+
+    std::vector<Path::Step> read();
+};
+
+std::string PathReader::name()
+{
+    size_t start = pos;
+    for (char c = peek(); std::isalnum(static_cast<unsigned char>(c)) != 0 ||
+                          c == '_' || c == '-' || c == '$' ||
+                          (static_cast<unsigned char>(c) & 0x80) != 0;
+         c = peek())
+    {
+        ++pos;
+    }
+    if (pos == start) {
+        fail("expected a name");
+    }
+    return std::string(text.substr(start, pos - start));
+}
+std::string PathReader::quoted()
+{
+    // 'single' or "double", with JSON's escapes (and \' in either)
+    char quote = peek();
+    ++pos;
+    std::string result;
+    while (peek() != quote) {
+        char c = peek();
+        if (pos >= text.size()) {
+            fail("unterminated string");
+        }
+        ++pos;
+        if (c != '\\') {
+            result += c;
+            continue;
+        }
+        c = peek();
+        ++pos;
+        switch (c) {
+            case '"':
+            case '\'':
+            case '\\':
+            case '/': result += c; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u':
+                if (pos + 4 > text.size() ||
+                    !std::all_of(text.begin() + static_cast<ptrdiff_t>(pos),
+                                 text.begin() + static_cast<ptrdiff_t>(pos + 4),
+                                 [](char h) {
+                                     return std::isxdigit(
+                                              static_cast<unsigned char>(h)) !=
+                                            0;
+                                 }))
+                {
+                    fail("invalid \\u escape");
+                }
+                pos = detail::appendUnicodeEscape(text, pos, result);
+                break;
+            default: --pos; fail("invalid escape");
+        }
+    }
+    ++pos;
+    return result;
+}
+int64_t PathReader::integer()
+{
+    int64_t value = 0;
+    auto [ptr, ec] =
+      std::from_chars(text.data() + pos, text.data() + text.size(), value);
+    if (ec != std::errc()) {
+        fail("expected an index");
+    }
+    pos = ptr - text.data();
+    return value;
+}
+JsonValue PathReader::literal()
+{
+    if (peek() == '\'' || peek() == '"') {
+        return quoted();
+    }
+    size_t start = pos;
+    while (pos < text.size() && std::string_view(" )&|]").find(peek()) ==
+                                  std::string_view::npos)
+    {
+        ++pos;
+    }
+    auto value = tryParse(text.substr(start, pos - start));
+    if (!value || value->isArray() || value->isObject()) {
+        pos = start;
+        fail("expected a number, string, true, false or null");
+    }
+    return std::move(*value);
+}
+Path::Comparison PathReader::comparison()
+{
+    using Op = Path::Comparison::Op;
+
+    skipSpaces();
+    expect('@');
+    // the operand as a JSON Pointer
+    std::string pointer;
+    auto addKey = [&](std::string_view key) {
+        pointer += '/';
+        for (char c : key) {
+            if (c == '~') {
+                pointer += "~0";
+            } else if (c == '/') {
+                pointer += "~1";
+            } else {
+                pointer += c;
+            }
+        }
+    };
+    while (true) {
+        if (eat(".")) {
+            addKey(name());
+        } else if (eat("[")) {
+            if (peek() == '\'' || peek() == '"') {
+                addKey(quoted());
+            } else {
+                int64_t index = integer();
+                if (index < 0) {
+                    fail("negative indices don't work in filters");
+                }
+                addKey(std::to_string(index));
+            }
+            expect(']');
+        } else {
+            break;
+        }
+    }
+
+    skipSpaces();
+    Op op = Op::Exists;
+    if (eat("==")) {
+        op = Op::Equal;
+    } else if (eat("!=")) {
+        op = Op::NotEqual;
+    } else if (eat("<=")) {
+        op = Op::LessEqual;
+    } else if (eat(">=")) {
+        op = Op::GreaterEqual;
+    } else if (eat("<")) {
+        op = Op::Less;
+    } else if (eat(">")) {
+        op = Op::Greater;
+    }
+    JsonValue value;
+    if (op != Op::Exists) {
+        skipSpaces();
+        value = literal();
+        skipSpaces();
+    }
+    return {.operand = Pointer(pointer), .op = op, .literal = std::move(value)};
+}
+Path::Step PathReader::bracket(bool descendant)
+{
+    Path::Step step{.kind = Path::Step::Kind::AnyMember,
+                    .descendant = descendant,
+                    .name = {},
+                    .hash = 0,
+                    .index = 0,
+                    .alternatives = {}};
+    skipSpaces();
+    if (eat("*")) {
+        // AnyMember already
+    } else if (peek() == '\'' || peek() == '"') {
+        step.kind = Path::Step::Kind::Member;
+        step.name = quoted();
+        step.hash = JsonObject::hashKey(step.name);
+    } else if (eat("?")) {
+        step.kind = Path::Step::Kind::Filter;
+        skipSpaces();
+        bool parenthesised = eat("(");
+        do {
+            auto& conditions = step.alternatives.emplace_back();
+            do {
+                conditions.push_back(comparison());
+            } while (eat("&&"));
+        } while (eat("||"));
+        if (parenthesised) {
+            expect(')');
+        }
+    } else {
+        step.kind = Path::Step::Kind::Index;
+        step.index = integer();
+    }
+    skipSpaces();
+    expect(']');
+    return step;
+}
+std::vector<Path::Step> PathReader::read()
+{
+    expect('$');
+    std::vector<Path::Step> steps;
+    while (pos < text.size()) {
+        bool descendant = eat("..");
+        if (eat("[")) {
+            steps.push_back(bracket(descendant));
+            continue;
+        }
+        if (!descendant) {
+            expect('.');
+        }
+        Path::Step step{.kind = Path::Step::Kind::AnyMember,
+                        .descendant = descendant,
+                        .name = {},
+                        .hash = 0,
+                        .index = 0,
+                        .alternatives = {}};
+        if (!eat("*")) {
+            step.kind = Path::Step::Kind::Member;
+            step.name = name();
+            step.hash = JsonObject::hashKey(step.name);
+        }
+        steps.push_back(std::move(step));
+    }
+    return steps;
+}
+
+// numbers with numbers and strings with strings, anything else is only
+// equal to itself if it's null or a bool
+std::partial_ordering compareValues(const JsonValue& a, const JsonValue& b)
+{
+    if (a.isNumber() && b.isNumber()) {
+        return a.asNumber() <=> b.asNumber();
+    }
+    if (a.isString() && b.isString()) {
+        return a.asString() <=> b.asString();
+    }
+    if (a.isBool() && b.isBool() && a.asBool() == b.asBool()) {
+        return std::partial_ordering::equivalent;
+    }
+    if (a.isNull() && b.isNull()) {
+        return std::partial_ordering::equivalent;
+    }
+    return std::partial_ordering::unordered;
+}
+bool holds(const Path::Comparison& comparison, const JsonValue* operand)
+{
+    using Op = Path::Comparison::Op;
+    if (comparison.op == Op::Exists) {
+        return operand != nullptr;
+    }
+    if (operand == nullptr) {
+        return comparison.op == Op::NotEqual;
+    }
+    std::partial_ordering order = compareValues(*operand, comparison.literal);
+    switch (comparison.op) {
+        case Op::Equal: return order == std::partial_ordering::equivalent;
+        case Op::NotEqual: return order != std::partial_ordering::equivalent;
+        case Op::Less: return order < 0;
+        case Op::LessEqual: return order <= 0;
+        case Op::Greater: return order > 0;
+        case Op::GreaterEqual: return order >= 0;
+        default: return false;
+    }
+}
+
+} // namespace
+
+// streamQuery's engine. each value gets a set of steps (bits of a mask)
+// that apply to its children, worked out from its parent's set and its key
+// or index when it starts. containers keep theirs on a stack, so that's all
+// the state there is. values that are matches, or that a filter has to look
+// at, have their text recorded and get parsed once they end.
+class detail::StreamMatcher
+{
+    static constexpr size_t bufferSize = 64 * 1024;
+    static constexpr int endOfInput = -1;
+
+    std::istream& input;
+    const std::vector<Path::Step>& steps;
+    const std::function<void(const JsonValue&)>& onMatch;
+    // for each filter step, what comes after it
+    std::vector<std::pair<size_t, Query>> rest;
+
+    std::vector<char> buffer = std::vector<char>(bufferSize);
+    size_t pos = 0;
+    size_t end = 0;
+    // bytes of input before buffer[0]
+    size_t offset = 0;
+    size_t line = 1;
+    // offset of the start of the current line
+    size_t lineStart = 0;
+
+    // what a value is to the path
+    struct Role
+    {
+        // steps that apply to its children
+        uint64_t active = 0;
+        // the last step selects it
+        bool match = false;
+        // filter steps that have to look at it
+        uint64_t filtered = 0;
+
+        [[nodiscard]] bool recorded() const { return match || filtered != 0; }
+    };
+    struct Frame
+    {
+        Role role;
+        bool object;
+        bool first = true;
+        size_t index = 0;
+    };
+    std::vector<Frame> frames;
+
+    // the text of the recorded values being read, from the start of the
+    // outermost one. buffer up to recordFrom is in it already.
+    std::string recorded;
+    size_t recordFrom = 0;
+    struct Recording
+    {
+        // where it starts in recorded, and in the input
+        size_t start;
+        size_t offset;
+        size_t line;
+        size_t col;
+    };
+    std::vector<Recording> recordings;
+
+    // the current key, and number and literal tokens
+    std::string key;
+    std::string token;
+
+    [[nodiscard]] size_t col() const { return offset + pos - lineStart + 1; }
+    [[noreturn]] void fail(ErrorCode code) const
+    {
+        detail::raise(ParsingError(ParseError{
+          .code = code, .offset = offset + pos, .line = line, .col = col()}));
+    }
+
+    bool refill()
+    {
+        flush();
+        offset += end;
+        input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        end = static_cast<size_t>(input.gcount());
+        pos = 0;
+        recordFrom = 0;
+        return end > 0;
+    }
+    int peek()
+    {
+        if (pos == end && !refill()) {
+            return endOfInput;
+        }
+        return static_cast<unsigned char>(buffer[pos]);
+    }
+    void newLine()
+    {
+        line++;
+        lineStart = offset + pos;
+    }
+    void flush()
+    {
+        if (!recordings.empty()) {
+            recorded.append(buffer.data() + recordFrom, pos - recordFrom);
+        }
+        recordFrom = pos;
+    }
+
+    void skipWhitespace();
+    // with the opening quote current. appends the string's text (quotes and
+    // all) to text if there is one
+    void skipString(std::string* text);
+    void skipScalar();
+    // skipString doesn't look at escapes cut off by the end of the buffer,
+    // keys get checked in full before they're unescaped
+    void checkEscapes(std::string_view string) const;
+    // with the opening bracket (of an object or not) just read
+    void skipContainer(bool object);
+
+    [[nodiscard]] Role childRole(uint64_t active, const std::string* key,
+                                 size_t index) const;
+    void startValue(const Role& role);
+    void endValue(const Role& role);
+
+   public:
+    StreamMatcher(std::istream& input, const std::vector<Path::Step>& steps,
+                  const std::function<void(const JsonValue&)>& onMatch)
+      : input(input), steps(steps), onMatch(onMatch)
+    {
+        for (size_t i = 0; i < steps.size(); ++i) {
+            if (steps[i].kind == Path::Step::Kind::Filter) {
+                rest.emplace_back(i, Query(steps, i + 1));
+            }
+        }
+    }
+
+    void run();
+};
+
+void detail::StreamMatcher::skipWhitespace()
+{
+    while (true) {
+        switch (peek()) {
+            case ' ':
+            case '\r':
+            case '\t': ++pos; break;
+            case '\n':
+                ++pos;
+                newLine();
+                break;
+            case '/': {
+                ++pos;
+                int next = peek();
+                if (next == '/') {
+                    for (int c = peek(); c != '\n' && c != endOfInput;
+                         c = peek())
+                    {
+                        ++pos;
+                    }
+                } else if (next == '*') {
+                    ++pos;
+                    bool star = false;
+                    for (int c = peek(); c != endOfInput; c = peek()) {
+                        ++pos;
+                        if (c == '\n') {
+                            newLine();
+                        } else if (star && c == '/') {
+                            break;
+                        }
+                        star = c == '*';
+                    }
+                } else {
+                    fail(ErrorCode::UnexpectedCharacter);
+                }
+                break;
+            }
+            default: return;
+        }
+    }
+}
+void detail::StreamMatcher::skipString(std::string* text)
+{
+    size_t start = pos;
+    ++pos;
+    auto keep = [&] {
+        if (text != nullptr) {
+            text->append(buffer.data() + start, pos - start);
+        }
+    };
+    while (true) {
+        while (pos < end && buffer[pos] != '"' && buffer[pos] != '\\' &&
+               buffer[pos] != '\n')
+        {
+            ++pos;
+        }
+        if (pos == end) {
+            keep();
+            if (!refill()) {
+                fail(ErrorCode::UnterminatedString);
+            }
+            start = 0;
+            continue;
+        }
+        char c = buffer[pos++];
+        if (c == '"') {
+            keep();
+            return;
+        }
+        if (c == '\n') {
+            newLine();
+        } else if (pos < end) {
+            // an escape
+            c = buffer[pos];
+            if (std::string_view("\"\\/bfnrtu").find(c) ==
+                std::string_view::npos)
+            {
+                fail(ErrorCode::InvalidEscape);
+            }
+            ++pos;
+        } else {
+            // the escape is cut off by the end of the buffer. the escaped
+            // character isn't a quote whatever it is, and unescapeString
+            // only gets to see strings parse has checked.
+            keep();
+            if (!refill()) {
+                fail(ErrorCode::UnterminatedString);
+            }
+            start = 0;
+            ++pos;
+        }
+    }
+}
+void detail::StreamMatcher::checkEscapes(std::string_view string) const
+{
+    for (size_t i = 1; i + 1 < string.size(); ++i) {
+        if (string[i] != '\\') {
+            continue;
+        }
+        char c = string[++i];
+        if (c == 'u') {
+            if (i + 5 >= string.size() ||
+                !std::all_of(string.begin() + static_cast<ptrdiff_t>(i + 1),
+                             string.begin() + static_cast<ptrdiff_t>(i + 5),
+                             [](char h) {
+                                 return std::isxdigit(
+                                          static_cast<unsigned char>(h)) != 0;
+                             }))
+            {
+                fail(ErrorCode::InvalidEscape);
+            }
+        } else if (std::string_view("\"\\/bfnrt").find(c) ==
+                   std::string_view::npos)
+        {
+            fail(ErrorCode::InvalidEscape);
+        }
+    }
+}
+void detail::StreamMatcher::skipScalar()
+{
+    int c = peek();
+    if (c == '"') {
+        skipString(nullptr);
+        return;
+    }
+    token.clear();
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        for (; (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+               c == 'e' || c == 'E';
+             c = peek())
+        {
+            token += static_cast<char>(c);
+            ++pos;
+        }
+        double number = 0;
+        if (auto code = detail::parseNumber(token, number);
+            code != ErrorCode::None)
+        {
+            fail(code);
+        }
+        return;
+    }
+    for (; (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); c = peek()) {
+        token += static_cast<char>(c);
+        ++pos;
+    }
+    if (token != "true" && token != "false" && token != "null") {
+        fail(token.empty() && (c == endOfInput ||
+                               std::string_view(",:]}").find(
+                                 static_cast<char>(c)) != std::string_view::npos)
+               ? ErrorCode::ExpectedValue
+               : ErrorCode::UnexpectedCharacter);
+    }
+}
+void detail::StreamMatcher::skipContainer(bool object)
+{
+    // a bit for each open container that's an object, like
+    // Lexer::skipContainer
+    uint64_t objects = object ? 1 : 0;
+    std::vector<bool> deeper;
+    size_t depth = 1;
+    while (true) {
+        if (pos == end && !refill()) {
+            fail(ErrorCode::ExpectedValue);
+        }
+        const char c = buffer[pos];
+        switch (c) {
+            case '{':
+            case '[':
+                if (depth >= 64) {
+                    deeper.push_back((objects >> 63) != 0);
+                }
+                objects = (objects << 1) | (c == '{' ? 1 : 0);
+                depth++;
+                ++pos;
+                break;
+            case '}':
+            case ']':
+                if (((objects & 1) != 0) != (c == '}')) {
+                    fail((objects & 1) != 0
+                           ? ErrorCode::ExpectedCommaOrBrace
+                           : ErrorCode::ExpectedCommaOrBracket);
+                }
+                ++pos;
+                if (--depth == 0) {
+                    return;
+                }
+                objects >>= 1;
+                if (depth >= 64) {
+                    objects |= static_cast<uint64_t>(deeper.back()) << 63;
+                    deeper.pop_back();
+                }
+                break;
+            case '"': skipString(nullptr); break;
+            case '/':
+            case '\n': skipWhitespace(); break;
+            default: ++pos;
+        }
+    }
+}
+
+detail::StreamMatcher::Role detail::StreamMatcher::childRole(uint64_t active,
+                                             const std::string* key,
+                                             size_t index) const
+{
+    Role role;
+    for (uint64_t bits = active; bits != 0; bits &= bits - 1) {
+        auto at = static_cast<size_t>(std::countr_zero(bits));
+        const Path::Step& step = steps[at];
+        if (step.descendant) {
+            role.active |= uint64_t{1} << at;
+        }
+        bool selected = false;
+        switch (step.kind) {
+            case Path::Step::Kind::Member:
+                selected = key != nullptr && *key == step.name;
+                break;
+            case Path::Step::Kind::AnyMember: selected = true; break;
+            case Path::Step::Kind::Index:
+                selected = key == nullptr &&
+                           index == static_cast<size_t>(step.index);
+                break;
+            case Path::Step::Kind::Filter:
+                role.filtered |= uint64_t{1} << at;
+                break;
+        }
+        if (selected && at + 1 == steps.size()) {
+            role.match = true;
+        } else if (selected) {
+            role.active |= uint64_t{1} << (at + 1);
+        }
+    }
+    return role;
+}
+void detail::StreamMatcher::startValue(const Role& role)
+{
+    int c = peek();
+    if (role.recorded()) {
+        if (recordings.empty()) {
+            recorded.clear();
+            recordFrom = pos;
+        } else {
+            flush();
+        }
+        recordings.push_back({.start = recorded.size(),
+                              .offset = offset + pos,
+                              .line = line,
+                              .col = col()});
+    }
+    if (c != '{' && c != '[') {
+        skipScalar();
+        endValue(role);
+        return;
+    }
+    ++pos;
+    if (role.active == 0) {
+        // nothing in here can match, unless it's inside something recorded
+        // (which takes care of itself)
+        skipContainer(c == '{');
+        endValue(role);
+        return;
+    }
+    frames.push_back({.role = role, .object = c == '{'});
+}
+void detail::StreamMatcher::endValue(const Role& role)
+{
+    if (!role.recorded()) {
+        return;
+    }
+    flush();
+    Recording recording = recordings.back();
+    recordings.pop_back();
+    auto value =
+      tryParse(std::string_view(recorded).substr(recording.start));
+    if (!value) {
+        ParseError error = value.error();
+        error.offset += recording.offset;
+        if (error.line == 1) {
+            error.col += recording.col - 1;
+        }
+        error.line += recording.line - 1;
+        detail::raise(ParsingError(error));
+    }
+
+    if (role.match) {
+        onMatch(*value);
+    }
+    for (uint64_t bits = role.filtered; bits != 0; bits &= bits - 1) {
+        auto at = static_cast<size_t>(std::countr_zero(bits));
+        if (!Query::passes(steps[at], *value)) {
+            continue;
+        }
+        const Query& query =
+          std::find_if(rest.begin(), rest.end(), [&](const auto& entry) {
+              return entry.first == at;
+          })->second;
+        for (const JsonValue* match : query.run(*value)) {
+            onMatch(*match);
+        }
+    }
+}
+void detail::StreamMatcher::run()
+{
+    // a byte order mark is skipped, like parse does
+    if (peek() == 0xEF && end - pos >= 3 &&
+        static_cast<unsigned char>(buffer[pos + 1]) == 0xBB &&
+        static_cast<unsigned char>(buffer[pos + 2]) == 0xBF)
+    {
+        pos += 3;
+    }
+    skipWhitespace();
+    Role root;
+    if (steps.empty()) {
+        root.match = true;
+    } else {
+        root.active = 1;
+    }
+    startValue(root);
+
+    while (!frames.empty()) {
+        skipWhitespace();
+        Frame& frame = frames.back();
+        int c = peek();
+        if (c == (frame.object ? '}' : ']')) {
+            ++pos;
+            Role role = frame.role;
+            frames.pop_back();
+            endValue(role);
+            continue;
+        }
+        if (!frame.first) {
+            if (c != ',') {
+                fail(frame.object ? ErrorCode::ExpectedCommaOrBrace
+                                  : ErrorCode::ExpectedCommaOrBracket);
+            }
+            ++pos;
+            skipWhitespace();
+        }
+        frame.first = false;
+
+        Role role;
+        if (frame.object) {
+            if (peek() != '"') {
+                fail(ErrorCode::ExpectedKey);
+            }
+            token.clear();
+            skipString(&token);
+            if (token.find('\\') != std::string::npos) {
+                checkEscapes(token);
+                detail::unescapeString(token, key);
+            } else {
+                key.assign(token, 1, token.size() - 2);
+            }
+            skipWhitespace();
+            if (peek() != ':') {
+                fail(ErrorCode::ExpectedColon);
+            }
+            ++pos;
+            skipWhitespace();
+            role = childRole(frame.role.active, &key, 0);
+        } else {
+            role = childRole(frame.role.active, nullptr, frame.index++);
+        }
+        // frame is gone once this pushes
+        startValue(role);
+    }
+
+    skipWhitespace();
+    if (peek() != endOfInput) {
+        fail(ErrorCode::TrailingContent);
+    }
+}
+
+Path::Path(std::string_view path) : stepList(PathReader(path).read())
+{
+}
+const std::vector<Path::Step>& Path::steps() const
+{
+    return stepList;
+}
+
+Query::Query(const std::vector<Path::Step>& steps, size_t from)
+  : steps(steps.begin() + static_cast<ptrdiff_t>(from), steps.end())
+{
+    for (size_t i = 0; i < this->steps.size(); ++i) {
+        const Path::Step& step = this->steps[i];
+        if (step.descendant) {
+            plan.push_back({.kind = Operation::Kind::Descend, .step = i});
+        }
+        switch (step.kind) {
+            case Path::Step::Kind::Member:
+                plan.push_back({.kind = Operation::Kind::Member, .step = i});
+                break;
+            case Path::Step::Kind::AnyMember:
+                plan.push_back({.kind = Operation::Kind::AnyMember, .step = i});
+                break;
+            case Path::Step::Kind::Index:
+                plan.push_back({.kind = Operation::Kind::Index, .step = i});
+                break;
+            case Path::Step::Kind::Filter:
+                plan.push_back({.kind = Operation::Kind::Filter, .step = i});
+                break;
+        }
+    }
+}
+Query::Query(const Path& path) : Query(path.steps(), 0)
+{
+}
+Query::Query(std::string_view path) : Query(Path(path))
+{
+}
+
+template <typename T>
+const T* Query::get(const JsonValue& value)
+{
+    if (const T* held = std::get_if<T>(&value.value)) {
+        return held;
+    }
+    if (!value.isRaw()) {
+        return nullptr;
+    }
+    return std::get_if<T>(&value.materialize().value);
+}
+const NumberArray* Query::numbers(const JsonValue& value)
+{
+    const auto* packed = get<detail::PackedArray>(value);
+    return packed == nullptr ? nullptr : &packed->numbers;
+}
+const JsonValue* Query::member(const JsonValue& value, std::string_view key,
+                               size_t hash, KeyCache& cache)
+{
+    const JsonObject* object = get<JsonObject>(value);
+    if (object == nullptr) {
+        return nullptr;
+    }
+    const detail::ObjectKeys* keys = object->keys.get();
+    if (keys == nullptr) {
+        return nullptr;
+    }
+    if (keys != cache.keys) {
+        cache = {.keys = keys, .pos = object->position(key, hash)};
+    }
+    return cache.pos < object->size() ? &object->memberValues[cache.pos]
+                                      : nullptr;
+}
+const JsonValue* Query::resolve(const JsonValue* value,
+                                const std::vector<Pointer::Segment>& path,
+                                KeyCache* caches, JsonValue& packed)
+{
+    for (size_t i = 0; i < path.size() && value != nullptr; ++i) {
+        const Pointer::Segment& segment = path[i];
+        if (const JsonArray* array = get<JsonArray>(*value)) {
+            value = segment.index && *segment.index < array->size()
+                    ? &(*array)[*segment.index]
+                    : nullptr;
+        } else if (const NumberArray* numbers = Query::numbers(*value)) {
+            if (!segment.index || *segment.index >= numbers->size()) {
+                return nullptr;
+            }
+            packed = JsonValue((*numbers)[*segment.index]);
+            value = &packed;
+        } else {
+            value = member(*value, segment.key, segment.hash, caches[i]);
+        }
+    }
+    return value;
+}
+void Query::filter(const Path::Step& step,
+                   std::vector<const JsonValue*>& candidates, size_t from)
+{
+    using Op = Path::Comparison::Op;
+    constexpr size_t batchSize = 256;
+
+    // a key cache for every segment of every operand
+    std::vector<std::vector<KeyCache>> caches;
+    for (const auto& conditions : step.alternatives) {
+        for (const Path::Comparison& comparison : conditions) {
+            caches.emplace_back(comparison.operand.segments().size());
+        }
+    }
+
+    std::array<const JsonValue*, batchSize> operands{};
+    std::array<JsonValue, batchSize> packed{};
+    std::array<double, batchSize> numbers{};
+    std::array<uint8_t, batchSize> isNumber{};
+    std::array<uint8_t, batchSize> holding{};
+    std::array<uint8_t, batchSize> kept{};
+    size_t keptCount = from;
+
+    for (size_t first = from; first < candidates.size(); first += batchSize) {
+        const size_t count = std::min(batchSize, candidates.size() - first);
+        const JsonValue* const* batch = candidates.data() + first;
+        kept.fill(0);
+        size_t condition = 0;
+
+        for (const auto& conditions : step.alternatives) {
+            holding.fill(1);
+            for (const Path::Comparison& comparison : conditions) {
+                KeyCache* cache = caches[condition++].data();
+                for (size_t i = 0; i < count; ++i) {
+                    operands[i] = holding[i] != 0
+                                  ? resolve(batch[i],
+                                            comparison.operand.segments(),
+                                            cache, packed[i])
+                                  : nullptr;
+                }
+
+                if (comparison.op == Op::Exists) {
+                    for (size_t i = 0; i < count; ++i) {
+                        holding[i] &= static_cast<uint8_t>(operands[i] !=
+                                                           nullptr);
+                    }
+                    continue;
+                }
+                const auto* string = get<std::string>(comparison.literal);
+                if (string != nullptr && (comparison.op == Op::Equal ||
+                                          comparison.op == Op::NotEqual))
+                {
+                    const bool equal = comparison.op == Op::Equal;
+                    for (size_t i = 0; i < count; ++i) {
+                        const JsonValue* operand = operands[i];
+                        const std::string* text = nullptr;
+                        if (operand != nullptr) {
+                            const auto* interned =
+                              get<InternedString>(*operand);
+                            text = interned != nullptr
+                                   ? interned->get()
+                                   : get<std::string>(*operand);
+                        }
+                        holding[i] &= static_cast<uint8_t>(
+                          (text != nullptr && *text == *string) == equal);
+                    }
+                    continue;
+                }
+                if (!comparison.literal.isNumber()) {
+                    for (size_t i = 0; i < count; ++i) {
+                        holding[i] &= static_cast<uint8_t>(
+                          holding[i] != 0 && holds(comparison, operands[i]));
+                    }
+                    continue;
+                }
+
+                // numbers out first, then compared without any branching
+                for (size_t i = 0; i < count; ++i) {
+                    const double* number =
+                      operands[i] != nullptr ? get<double>(*operands[i])
+                                             : nullptr;
+                    isNumber[i] = static_cast<uint8_t>(number != nullptr);
+                    numbers[i] = number != nullptr ? *number : 0;
+                }
+                const double literal = comparison.literal.asNumber();
+                auto compare = [&](auto&& test) {
+                    for (size_t i = 0; i < count; ++i) {
+                        holding[i] &= static_cast<uint8_t>(
+                          isNumber[i] & static_cast<uint8_t>(test(numbers[i])));
+                    }
+                };
+                switch (comparison.op) {
+                    case Op::Equal:
+                        compare([&](double n) { return n == literal; });
+                        break;
+                    case Op::NotEqual:
+                        // anything that isn't a number is != too
+                        for (size_t i = 0; i < count; ++i) {
+                            holding[i] &= static_cast<uint8_t>(
+                              (isNumber[i] == 0) | (numbers[i] != literal));
+                        }
+                        break;
+                    case Op::Less:
+                        compare([&](double n) { return n < literal; });
+                        break;
+                    case Op::LessEqual:
+                        compare([&](double n) { return n <= literal; });
+                        break;
+                    case Op::Greater:
+                        compare([&](double n) { return n > literal; });
+                        break;
+                    case Op::GreaterEqual:
+                        compare([&](double n) { return n >= literal; });
+                        break;
+                    default: break;
+                }
+            }
+            for (size_t i = 0; i < count; ++i) {
+                kept[i] |= holding[i];
+            }
+        }
+
+        // in place, nothing kept can be ahead of where it's read from
+        for (size_t i = 0; i < count; ++i) {
+            if (kept[i] != 0) {
+                candidates[keptCount++] = batch[i];
+            }
+        }
+    }
+    candidates.resize(keptCount);
+}
+bool Query::passes(const Path::Step& filter, const JsonValue& value)
+{
+    JsonValue packed;
+    return std::any_of(
+      filter.alternatives.begin(), filter.alternatives.end(),
+      [&](const auto& conditions) {
+          return std::all_of(
+            conditions.begin(), conditions.end(),
+            [&](const Path::Comparison& comparison) {
+                const auto& path = comparison.operand.segments();
+                std::vector<KeyCache> caches(path.size());
+                return holds(comparison,
+                             resolve(&value, path, caches.data(), packed));
+            });
+      });
+}
+
+Selection Query::run(const JsonValue& root) const
+{
+    Selection selection;
+    std::vector<const JsonValue*> current{&root};
+    std::vector<const JsonValue*> next;
+
+    // elements of packed arrays get copied into the selection when a step
+    // reaches them, the array itself is left as it is
+    auto copy = [&](double number) {
+        next.push_back(&selection.copies.emplace_back(number));
+    };
+    auto children = [&](const JsonValue& value) {
+        if (const JsonArray* array = get<JsonArray>(value)) {
+            for (const JsonValue& element : *array) {
+                next.push_back(&element);
+            }
+        } else if (const NumberArray* numbers = Query::numbers(value)) {
+            for (double number : *numbers) {
+                copy(number);
+            }
+        } else if (const JsonObject* object = get<JsonObject>(value)) {
+            for (const auto& [key, member] : *object) {
+                next.push_back(&member);
+            }
+        }
+    };
+    auto descend = [&](auto&& self, const JsonValue& value) -> void {
+        next.push_back(&value);
+        if (const JsonArray* array = get<JsonArray>(value)) {
+            for (const JsonValue& element : *array) {
+                self(self, element);
+            }
+        } else if (const NumberArray* numbers = Query::numbers(value)) {
+            for (double number : *numbers) {
+                copy(number);
+            }
+        } else if (const JsonObject* object = get<JsonObject>(value)) {
+            for (const auto& [key, member] : *object) {
+                self(self, member);
+            }
+        }
+    };
+
+    for (const Operation& operation : plan) {
+        const Path::Step& step = steps[operation.step];
+        next.clear();
+        switch (operation.kind) {
+            case Operation::Kind::Descend:
+                for (const JsonValue* value : current) {
+                    descend(descend, *value);
+                }
+                break;
+            case Operation::Kind::Member: {
+                KeyCache cache;
+                for (const JsonValue* value : current) {
+                    if (const JsonValue* found =
+                          member(*value, step.name, step.hash, cache))
+                    {
+                        next.push_back(found);
+                    }
+                }
+                break;
+            }
+            case Operation::Kind::AnyMember:
+                for (const JsonValue* value : current) {
+                    children(*value);
+                }
+                break;
+            case Operation::Kind::Index:
+                for (const JsonValue* value : current) {
+                    const JsonArray* array = get<JsonArray>(*value);
+                    const NumberArray* numbers = Query::numbers(*value);
+                    if (array == nullptr && numbers == nullptr) {
+                        continue;
+                    }
+                    auto size = static_cast<int64_t>(array ? array->size()
+                                                           : numbers->size());
+                    int64_t index = step.index < 0 ? size + step.index
+                                                   : step.index;
+                    if (index < 0 || index >= size) {
+                        continue;
+                    }
+                    if (array != nullptr) {
+                        next.push_back(&(*array)[static_cast<size_t>(index)]);
+                    } else {
+                        copy((*numbers)[static_cast<size_t>(index)]);
+                    }
+                }
+                break;
+            case Operation::Kind::Filter: {
+                // the numbers of a packed array go through the filter a
+                // batch at a time in a scratch buffer, and only the ones
+                // kept get copied into the selection
+                size_t unfiltered = 0;
+                std::vector<JsonValue> batch;
+                for (const JsonValue* value : current) {
+                    const NumberArray* numbers = Query::numbers(*value);
+                    if (numbers == nullptr) {
+                        children(*value);
+                        continue;
+                    }
+                    filter(step, next, unfiltered);
+                    for (size_t first = 0; first < numbers->size();
+                         first += 256)
+                    {
+                        const size_t last =
+                          std::min(first + 256, numbers->size());
+                        batch.assign(numbers->begin() + first,
+                                     numbers->begin() + last);
+                        const size_t kept = next.size();
+                        for (const JsonValue& element : batch) {
+                            next.push_back(&element);
+                        }
+                        filter(step, next, kept);
+                        for (size_t i = kept; i < next.size(); ++i) {
+                            next[i] = &selection.copies.emplace_back(*next[i]);
+                        }
+                    }
+                    unfiltered = next.size();
+                }
+                filter(step, next, unfiltered);
+                break;
+            }
+        }
+        std::swap(current, next);
+        if (current.empty()) {
+            break;
+        }
+    }
+    selection.values = std::move(current);
+    return selection;
+}
+
+void streamQuery(std::istream& input, const Path& path,
+                 const std::function<void(const JsonValue&)>& onMatch)
+{
+    const auto& steps = path.steps();
+    if (steps.size() > 63) {
+        detail::raise(std::invalid_argument(
+          "streamQuery: paths can have at most 63 steps"));
+    }
+    for (const Path::Step& step : steps) {
+        if (step.kind == Path::Step::Kind::Index && step.index < 0) {
+            detail::raise(std::invalid_argument(
+              "streamQuery: negative indices need the whole array"));
+        }
+    }
+    detail::StreamMatcher(input, steps, onMatch).run();
+}
+
+} // namespace json
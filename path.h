@@ -0,0 +1,186 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// JSONPath queries. the subset understood is the one people actually use:
+//
+//   $                  the root
+//   .name ['name']     a member
+//   .* [*]             every member or element
+//   [2] [-1]           an element (negative counts from the end)
+//   ..name ..* ..[0]   the same, at any depth below
+//   [?(@.price > 10)]  members or elements the filter holds for
+//
+// filters compare a value below @ (written .a.b or ['a'][0], or just @) with
+// a number, string, true, false or null using == != < <= > >=, or only check
+// it exists. they can be joined with && and || (&& binds tighter), without
+// parentheses. numbers compare with numbers and strings with strings
+// (bytewise), anything else is only ever != .
+
+namespace json
+{
+
+namespace detail
+{
+class StreamMatcher;
+}
+
+class Path
+{
+   public:
+    struct Comparison
+    {
+        enum class Op : uint8_t {
+            Exists,
+            Equal,
+            NotEqual,
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual
+        };
+        // what's compared, relative to @
+        Pointer operand;
+        Op op;
+        JsonValue literal;
+    };
+    struct Step
+    {
+        enum class Kind : uint8_t { Member, AnyMember, Index, Filter };
+        Kind kind;
+        // written with .. in front, so it applies at any depth below
+        bool descendant;
+        // Member, and JsonObject::hashKey(name)
+        std::string name;
+        size_t hash;
+        // Index
+        int64_t index;
+        // Filter: holds if all the comparisons of any one alternative do
+        std::vector<std::vector<Comparison>> alternatives;
+    };
+
+   private:
+    std::vector<Step> stepList;
+
+   public:
+    // !!throws std::invalid_argument if path isn't valid or uses something
+    // outside the subset!!
+    explicit Path(std::string_view path);
+
+    [[nodiscard]] const std::vector<Step>& steps() const;
+};
+
+// what a Query selected. the pointers are into the value it ran over,
+// except for elements of packed arrays (see JsonValue::isNumberArray()):
+// those aren't JsonValues in the document, so the selection holds copies of
+// them. it can be moved (the pointers stay valid) but not copied.
+class Selection
+{
+    std::vector<const JsonValue*> values;
+    std::deque<JsonValue> copies;
+
+    friend class Query;
+
+   public:
+    Selection() = default;
+    Selection(Selection&&) = default;
+    Selection& operator=(Selection&&) = default;
+
+    [[nodiscard]] size_t size() const { return values.size(); }
+    [[nodiscard]] bool empty() const { return values.empty(); }
+    const JsonValue* operator[](size_t i) const { return values[i]; }
+    [[nodiscard]] auto begin() const { return values.begin(); }
+    [[nodiscard]] auto end() const { return values.end(); }
+};
+
+// a Path turned into a plan for running over parsed values. the plan goes
+// a step at a time over everything the step before selected, rather than
+// down one value at a time, so a filter gets all the elements it looks at
+// together: it checks them in batches, one comparison at a time, reading
+// the operands out first and then comparing numbers in a tight loop.
+// member lookups remember where the last object with the same keys (see
+// detail::ObjectKeys) had the member, so in an array of records sharing
+// their keys the key is only looked for once.
+class Query
+{
+    struct Operation
+    {
+        // Descend selects a value and everything below it, and goes in
+        // front of .. steps. the rest are the step's own.
+        enum class Kind : uint8_t { Descend, Member, AnyMember, Index, Filter };
+        Kind kind;
+        // into steps
+        size_t step;
+    };
+    std::vector<Path::Step> steps;
+    std::vector<Operation> plan;
+
+    // for streamQuery, which runs what comes after a filter on the values
+    // the filter held for
+    Query(const std::vector<Path::Step>& steps, size_t from);
+    friend class detail::StreamMatcher;
+
+    // value's T, nullptr if it holds something else. raw values get
+    // materialized first.
+    template <typename T>
+    static const T* get(const JsonValue& value);
+    // a packed array's numbers, nullptr if value isn't one
+    static const NumberArray* numbers(const JsonValue& value);
+
+    // where a member was in the last object with the same keys
+    struct KeyCache
+    {
+        const detail::ObjectKeys* keys = nullptr;
+        size_t pos = 0;
+    };
+    static const JsonValue* member(const JsonValue& value, std::string_view key,
+                                   size_t hash, KeyCache& cache);
+    // an element of a packed array is copied into packed
+    static const JsonValue* resolve(const JsonValue* value,
+                                    const std::vector<Pointer::Segment>& path,
+                                    KeyCache* caches, JsonValue& packed);
+    // keeps the candidates (from from on) the filter step holds for, in
+    // order
+    static void filter(const Path::Step& step,
+                       std::vector<const JsonValue*>& candidates,
+                       size_t from = 0);
+    // whether the filter step holds for one value
+    static bool passes(const Path::Step& filter, const JsonValue& value);
+
+   public:
+    explicit Query(const Path& path);
+    // !!throws std::invalid_argument like Path does!!
+    explicit Query(std::string_view path);
+
+    // what the path selects in root, in document order except that .. lists
+    // what it finds among a value's children before going further down. the
+    // pointers are valid until root is modified. root isn't modified itself,
+    // so several threads can query the same value at once.
+    [[nodiscard]] Selection run(const JsonValue& root) const;
+};
+
+// runs path over the JSON text read from input without building it. values
+// are only built for the matches themselves (and for the elements a filter
+// looks at), so memory stays a few bytes per level of nesting plus whatever
+// the biggest match takes, however big the input is. parts no step can match
+// in are skipped without being lexed, so like parse with a Projection they're
+// only checked for balanced brackets and closed strings and comments.
+//
+// onMatch gets each match as soon as its last byte has been read, which
+// means a match inside another one comes first.
+// !!throws ParsingError on invalid input (offsets count from where input
+// was), std::invalid_argument if path has a negative index (there's no
+// telling where the end is)!!
+void streamQuery(std::istream& input, const Path& path,
+                 const std::function<void(const JsonValue&)>& onMatch);
+
+} // namespace json
@@ -0,0 +1,520 @@
+#pragma once
+
+// the parts of reading and writing JSON text below the grammar (numbers,
+// UTF-8 and escapes), constexpr so that the run time code and the compile
+// time code in literal.h and bind.h share them and agree on every value. not
+// part of the public interface.
+
+#include "json.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace json::detail
+{
+
+// length of the UTF-8 encoded character at bytes, 0 if it isn't valid UTF-8
+// (overlong, a surrogate, past U+10FFFF, or cut off by the end)
+constexpr size_t utf8SequenceLength(const char* bytes, size_t available)
+{
+    auto byte = [&](size_t i) { return static_cast<unsigned char>(bytes[i]); };
+    auto continuation = [&](size_t i) { return (byte(i) & 0xC0) == 0x80; };
+
+    unsigned char lead = byte(0);
+    if (lead < 0x80) {
+        return 1;
+    }
+    // the second byte's range depends on the lead byte, that's what rules
+    // out overlong encodings, surrogates and anything past U+10FFFF
+    size_t length = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) {
+            low = 0xA0;
+        } else if (lead == 0xED) {
+            high = 0x9F;
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) {
+            low = 0x90;
+        } else if (lead == 0xF4) {
+            high = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+    if (available < length || byte(1) < low || byte(1) > high) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; ++i) {
+        if (!continuation(i)) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// the four hex digits at view[pos] as a number, -1 if they aren't four hex
+// digits
+constexpr int32_t hexQuad(std::string_view view, size_t pos)
+{
+    if (pos + 4 > view.size()) {
+        return -1;
+    }
+    int32_t value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = view[i];
+        int32_t digit = -1;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        if (digit < 0) {
+            return -1;
+        }
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// decodes the \u escape whose hex digits start at view[pos], passing its
+// UTF-8 encoding to add one char at a time. a surrogate pair of escapes is
+// one character, a surrogate without its other half becomes U+FFFD. returns
+// where the escape (or the pair of them) ends, or pos if there aren't four
+// hex digits there.
+template <typename Add>
+constexpr size_t decodeUnicodeEscape(std::string_view view, size_t pos,
+                                     Add&& add)
+{
+    int32_t high = hexQuad(view, pos);
+    if (high < 0) {
+        return pos;
+    }
+    auto code = static_cast<uint32_t>(high);
+    pos += 4;
+    // characters outside the BMP come as a surrogate pair of escapes
+    if (code >= 0xD800 && code <= 0xDBFF && view.substr(pos, 2) == "\\u") {
+        int32_t low = hexQuad(view, pos + 2);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            code = 0x10000 + ((code - 0xD800) << 10) +
+                   (static_cast<uint32_t>(low) - 0xDC00);
+            pos += 6;
+        }
+    }
+    // a surrogate without its other half can't be encoded in UTF-8
+    if (code >= 0xD800 && code <= 0xDFFF) {
+        code = 0xFFFD;
+    }
+
+    if (code < 0x80) {
+        add(static_cast<char>(code));
+    } else if (code < 0x800) {
+        add(static_cast<char>(0xC0 | (code >> 6)));
+        add(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        add(static_cast<char>(0xE0 | (code >> 12)));
+        add(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        add(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        add(static_cast<char>(0xF0 | (code >> 18)));
+        add(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        add(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        add(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    return pos;
+}
+
+// hands str to write (a const char* and a length at a time) with everything
+// JSON requires escaped, but without the quotes
+template <typename Write>
+constexpr void writeEscaped(std::string_view str, Write&& write)
+{
+    constexpr char hexDigits[] = "0123456789abcdef";
+
+    size_t clean = 0; // start of the run of characters needing no escaping
+    for (size_t i = 0; i < str.length(); ++i) {
+        auto c = static_cast<unsigned char>(str[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        write(str.data() + clean, i - clean);
+        clean = i + 1;
+        switch (c) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default: {
+                const char escape[] = {'\\', 'u', '0', '0', hexDigits[c >> 4],
+                                       hexDigits[c & 0xF]};
+                write(escape, sizeof(escape));
+            }
+        }
+    }
+    write(str.data() + clean, str.length() - clean);
+}
+
+// an unsigned integer of up to 4096 bits, just what decimalToDouble needs
+class BigNumber
+{
+    // least significant first
+    std::array<uint32_t, 128> limbs{};
+    size_t used = 0;
+
+   public:
+    constexpr BigNumber() = default;
+    constexpr explicit BigNumber(uint64_t value)
+    {
+        while (value != 0) {
+            limbs[used++] = static_cast<uint32_t>(value);
+            value >>= 32;
+        }
+    }
+
+    [[nodiscard]] constexpr bool isZero() const { return used == 0; }
+    [[nodiscard]] constexpr size_t bitWidth() const
+    {
+        if (used == 0) {
+            return 0;
+        }
+        return (used - 1) * 32 +
+               static_cast<size_t>(std::bit_width(limbs[used - 1]));
+    }
+    [[nodiscard]] constexpr bool bit(size_t i) const
+    {
+        return i / 32 < used && ((limbs[i / 32] >> (i % 32)) & 1) != 0;
+    }
+    // whether any of the bits below the i-th are set
+    [[nodiscard]] constexpr bool anyBelow(size_t i) const
+    {
+        for (size_t limb = 0; limb < i / 32 && limb < used; ++limb) {
+            if (limbs[limb] != 0) {
+                return true;
+            }
+        }
+        return i / 32 < used && i % 32 != 0 &&
+               (limbs[i / 32] & ((uint32_t{1} << (i % 32)) - 1)) != 0;
+    }
+    // the 64 bits from the i-th up (the i-th is the lowest)
+    [[nodiscard]] constexpr uint64_t bitsFrom(size_t i) const
+    {
+        uint64_t result = 0;
+        for (size_t b = 0; b < 64; ++b) {
+            if (bit(i + b)) {
+                result |= uint64_t{1} << b;
+            }
+        }
+        return result;
+    }
+
+    constexpr void multiplyAdd(uint32_t factor, uint32_t addend)
+    {
+        uint64_t carry = addend;
+        for (size_t i = 0; i < used; ++i) {
+            uint64_t product = uint64_t{limbs[i]} * factor + carry;
+            limbs[i] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            limbs[used++] = static_cast<uint32_t>(carry);
+        }
+    }
+    constexpr void multiplyByPowerOfTen(int power)
+    {
+        for (; power >= 9; power -= 9) {
+            multiplyAdd(1000000000, 0);
+        }
+        uint32_t rest = 1;
+        for (; power > 0; --power) {
+            rest *= 10;
+        }
+        multiplyAdd(rest, 0);
+    }
+    constexpr void shiftLeft(size_t bits)
+    {
+        if (used == 0) {
+            return;
+        }
+        const size_t limbShift = bits / 32;
+        const unsigned bitShift = bits % 32;
+        limbs[used + limbShift] = 0;
+        for (size_t i = used; i-- > 0;) {
+            uint64_t wide = uint64_t{limbs[i]} << bitShift;
+            limbs[i + limbShift + 1] |= static_cast<uint32_t>(wide >> 32);
+            limbs[i + limbShift] = static_cast<uint32_t>(wide);
+        }
+        for (size_t i = 0; i < limbShift; ++i) {
+            limbs[i] = 0;
+        }
+        used += limbShift + 1;
+        trim();
+    }
+    constexpr void shiftRightOne()
+    {
+        for (size_t i = 0; i < used; ++i) {
+            limbs[i] >>= 1;
+            if (i + 1 < used) {
+                limbs[i] |= limbs[i + 1] << 31;
+            }
+        }
+        trim();
+    }
+    [[nodiscard]] constexpr int compare(const BigNumber& other) const
+    {
+        if (used != other.used) {
+            return used < other.used ? -1 : 1;
+        }
+        for (size_t i = used; i-- > 0;) {
+            if (limbs[i] != other.limbs[i]) {
+                return limbs[i] < other.limbs[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+    // other must not be bigger
+    constexpr void subtract(const BigNumber& other)
+    {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < used; ++i) {
+            int64_t difference = int64_t{limbs[i]} - borrow -
+                                 (i < other.used ? int64_t{other.limbs[i]} : 0);
+            borrow = difference < 0 ? 1 : 0;
+            limbs[i] = static_cast<uint32_t>(difference + (borrow << 32));
+        }
+        trim();
+    }
+
+   private:
+    constexpr void trim()
+    {
+        while (used > 0 && limbs[used - 1] == 0) {
+            used--;
+        }
+    }
+};
+
+// the double nearest q * 2^binaryExponent (ties to even), where sticky says
+// the real value is a bit more than that. out of range if it's too big for a
+// double, or so small it rounds to zero, same as std::from_chars.
+constexpr ErrorCode roundToDouble(uint64_t q, int binaryExponent, bool sticky,
+                                  bool negative, double& value)
+{
+    const int width = std::bit_width(q);
+    const int exponent = width - 1 + binaryExponent;
+    if (exponent > 1023) {
+        return ErrorCode::NumberOutOfRange;
+    }
+    // how many of q's bits don't fit, more of them for subnormals
+    int shift = width - 53;
+    if (exponent < -1022) {
+        shift += -1022 - exponent;
+    }
+    uint64_t mantissa = 0;
+    if (shift <= 0) {
+        mantissa = q << -shift;
+    } else if (shift <= 64) {
+        mantissa = shift == 64 ? 0 : q >> shift;
+        uint64_t rest = shift == 64 ? q : q & ((uint64_t{1} << shift) - 1);
+        uint64_t half = uint64_t{1} << (shift - 1);
+        if (rest > half ||
+            (rest == half && (sticky || (mantissa & 1) != 0)))
+        {
+            mantissa++;
+        }
+    }
+    uint64_t bits = mantissa;
+    if (exponent >= -1022) {
+        // a carry out of the mantissa moves on to the exponent by itself
+        bits = (static_cast<uint64_t>(exponent + 1023) << 52) +
+               (mantissa - (uint64_t{1} << 52));
+    }
+    if (bits >= 0x7FF0000000000000ULL || bits == 0) {
+        return ErrorCode::NumberOutOfRange;
+    }
+    value = std::bit_cast<double>(bits | (negative ? 1ULL << 63 : 0));
+    return ErrorCode::None;
+}
+
+// parses a number token's lexeme into value, correctly rounded. this is what
+// parseNumber does while compiling, and it returns the same values and errors
+// std::from_chars does at run time.
+constexpr ErrorCode decimalToDouble(std::string_view lexeme, double& value)
+{
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    size_t pos = 0;
+    const bool negative = !lexeme.empty() && lexeme[0] == '-';
+    if (negative) {
+        pos++;
+    }
+
+    // the significant digits, up to a limit past which they can't change
+    // the rounding (other than being all zeros or not)
+    constexpr int maxDigits = 800;
+    std::array<char, maxDigits + 1> significant{};
+    uint64_t small = 0;
+    int count = 0;
+    bool dropped = false;
+    // digits * 10^exponent is the number
+    int64_t exponent = 0;
+    auto addDigit = [&](char c, bool fraction) {
+        if (count == 0 && c == '0') {
+            exponent -= fraction ? 1 : 0;
+            return;
+        }
+        if (count == maxDigits) {
+            dropped = dropped || c != '0';
+            exponent += fraction ? 0 : 1;
+            return;
+        }
+        if (count < 19) {
+            small = small * 10 + static_cast<uint64_t>(c - '0');
+        }
+        significant[count++] = c;
+        exponent -= fraction ? 1 : 0;
+    };
+
+    bool sawDigit = false;
+    for (; pos < lexeme.size() && isDigit(lexeme[pos]); ++pos) {
+        addDigit(lexeme[pos], false);
+        sawDigit = true;
+    }
+    if (pos < lexeme.size() && lexeme[pos] == '.' &&
+        (sawDigit || (pos + 1 < lexeme.size() && isDigit(lexeme[pos + 1]))))
+    {
+        for (++pos; pos < lexeme.size() && isDigit(lexeme[pos]); ++pos) {
+            addDigit(lexeme[pos], true);
+            sawDigit = true;
+        }
+    }
+    if (!sawDigit) {
+        return ErrorCode::InvalidNumber;
+    }
+    // an exponent only counts if it has digits, otherwise the 'e' is where
+    // the number stops
+    if (pos < lexeme.size() && (lexeme[pos] == 'e' || lexeme[pos] == 'E')) {
+        size_t at = pos + 1;
+        bool negativeExponent = false;
+        if (at < lexeme.size() && (lexeme[at] == '+' || lexeme[at] == '-')) {
+            negativeExponent = lexeme[at] == '-';
+            at++;
+        }
+        if (at < lexeme.size() && isDigit(lexeme[at])) {
+            int64_t written = 0;
+            for (; at < lexeme.size() && isDigit(lexeme[at]); ++at) {
+                written = std::min<int64_t>(written * 10 + (lexeme[at] - '0'),
+                                            int64_t{1} << 40);
+            }
+            exponent += negativeExponent ? -written : written;
+            pos = at;
+        }
+    }
+    if (pos != lexeme.size()) {
+        return ErrorCode::InvalidCharactersInNumber;
+    }
+
+    if (count == 0) {
+        value = negative ? -0.0 : 0.0;
+        return ErrorCode::None;
+    }
+    if (dropped) {
+        // anything between digits and digits + 1 rounds the same
+        significant[count++] = '1';
+        exponent--;
+    }
+    // at least 10^310 or below 10^-343, which is less than half the smallest
+    // subnormal
+    if (count + exponent > 310 || count + exponent < -343) {
+        return ErrorCode::NumberOutOfRange;
+    }
+
+    // both the digits and the power of ten are exact doubles, so there's
+    // only one rounding
+    constexpr std::array<double, 23> powers = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (count <= 19 && small <= (uint64_t{1} << 53) && exponent >= -22 &&
+        exponent <= 22)
+    {
+        auto exact = static_cast<double>(small);
+        exact = exponent < 0 ? exact / powers[-exponent]
+                             : exact * powers[exponent];
+        value = negative ? -exact : exact;
+        return ErrorCode::None;
+    }
+
+    // nine digits at a time
+    BigNumber digits;
+    for (int i = 0; i < count; i += 9) {
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for (int j = i; j < count && j < i + 9; ++j) {
+            chunk = chunk * 10 + static_cast<uint32_t>(significant[j] - '0');
+            scale *= 10;
+        }
+        digits.multiplyAdd(scale, chunk);
+    }
+    if (exponent >= 0) {
+        // a whole number: round its top 64 bits
+        digits.multiplyByPowerOfTen(static_cast<int>(exponent));
+        const size_t width = digits.bitWidth();
+        const size_t low = width > 64 ? width - 64 : 0;
+        return roundToDouble(digits.bitsFrom(low), static_cast<int>(low),
+                             digits.anyBelow(low), negative, value);
+    }
+    // digits / 10^-exponent: scale one or the other by a power of two so
+    // the quotient has 63 or 64 bits, then divide a bit at a time, anything
+    // left over being the sticky bit
+    BigNumber divisor(1);
+    divisor.multiplyByPowerOfTen(static_cast<int>(-exponent));
+    const int64_t scale = static_cast<int64_t>(divisor.bitWidth()) -
+                          static_cast<int64_t>(digits.bitWidth()) + 63;
+    if (scale >= 0) {
+        digits.shiftLeft(static_cast<size_t>(scale));
+    } else {
+        divisor.shiftLeft(static_cast<size_t>(-scale));
+    }
+    divisor.shiftLeft(63);
+    uint64_t quotient = 0;
+    for (int b = 63; b >= 0; --b) {
+        if (digits.compare(divisor) >= 0) {
+            digits.subtract(divisor);
+            quotient |= uint64_t{1} << b;
+        }
+        divisor.shiftRightOne();
+    }
+    return roundToDouble(quotient, static_cast<int>(-scale), !digits.isZero(),
+                         negative, value);
+}
+
+// std::from_chars, with its errors turned into ours
+ErrorCode fromChars(std::string_view lexeme, double& value);
+
+// parses a number token's lexeme into value. returns the problem if it isn't
+// a valid double, ErrorCode::None if it is. at run time that's
+// std::from_chars, while compiling decimalToDouble, which agrees with it bit
+// for bit.
+constexpr ErrorCode parseNumber(std::string_view lexeme, double& value)
+{
+    if (std::is_constant_evaluated()) {
+        return decimalToDouble(lexeme, value);
+    }
+    return fromChars(lexeme, value);
+}
+
+} // namespace json::detail
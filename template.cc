@@ -0,0 +1,115 @@
+#include "template.h"
+
+#include <sstream>
+
+namespace json
+{
+
+Template::Template(std::string_view text)
+{
+    compile(text, false);
+}
+Template Template::from(const JsonValue& value)
+{
+    std::ostringstream os;
+    serialiseCompact(value, os);
+    Template result;
+    result.compile(os.view(), true);
+    return result;
+}
+
+void Template::compile(std::string_view text, bool quotedSlots)
+{
+    // the text with null in every slot, to check it's valid JSON
+    std::string check;
+    size_t constantStart = 0;
+
+    auto addSlot = [&](size_t start, size_t end, std::string_view name) {
+        constants.append(text.substr(constantStart, start - constantStart));
+        check.append(text.substr(constantStart, start - constantStart));
+        check += "null";
+        constantStart = end;
+
+        // whitespace around the name is fine
+        size_t first = name.find_first_not_of(" \t\r\n");
+        size_t last = name.find_last_not_of(" \t\r\n");
+        name = first == std::string_view::npos
+                 ? std::string_view()
+                 : name.substr(first, last - first + 1);
+        auto found = std::find(slotNames.begin(), slotNames.end(), name);
+        if (found == slotNames.end()) {
+            found = slotNames.emplace(slotNames.end(), name);
+        }
+        segments.push_back({.end = constants.size(),
+                            .slot = static_cast<size_t>(found -
+                                                        slotNames.begin())});
+    };
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') {
+            size_t start = i;
+            for (++i; i < text.size() && text[i] != '"'; ++i) {
+                if (text[i] == '\\') {
+                    ++i;
+                }
+            }
+            std::string_view string = text.substr(start, i + 1 - start);
+            // a key is followed straight by its colon in compact output,
+            // and stays a key
+            const bool key = i + 1 < text.size() && text[i + 1] == ':';
+            if (quotedSlots && !key && string.size() >= 6 &&
+                string.starts_with("\"{{") && string.ends_with("}}\""))
+            {
+                addSlot(start, i + 1, string.substr(3, string.size() - 6));
+            }
+        } else if (!quotedSlots && text.substr(i, 2) == "{{") {
+            size_t close = text.find("}}", i + 2);
+            if (close == std::string_view::npos) {
+                break; // the check below will complain about the brace
+            }
+            addSlot(i, close + 2, text.substr(i + 2, close - i - 2));
+            i = close + 1;
+        }
+    }
+    constants.append(text.substr(constantStart));
+    check.append(text.substr(constantStart));
+    segments.push_back({.end = constants.size(), .slot = std::string::npos});
+
+    (void)parse(check);
+}
+
+const std::vector<std::string>& Template::slots() const
+{
+    return slotNames;
+}
+
+void Template::renderValues(std::string& out, std::string_view values,
+                            const size_t* ends, size_t count) const
+{
+    if (count != slotNames.size()) {
+        detail::raise(std::invalid_argument(
+          "Template::render: expected " + std::to_string(slotNames.size()) +
+          " arguments, got " + std::to_string(count)));
+    }
+
+    size_t length = constants.size();
+    for (const Segment& segment : segments) {
+        if (segment.slot != std::string::npos) {
+            length += ends[segment.slot + 1] - ends[segment.slot];
+        }
+    }
+    out.reserve(out.size() + length);
+
+    size_t start = 0;
+    for (const Segment& segment : segments) {
+        out.append(constants, start, segment.end - start);
+        start = segment.end;
+        if (segment.slot != std::string::npos) {
+            out.append(values.substr(ends[segment.slot],
+                                     ends[segment.slot + 1] -
+                                       ends[segment.slot]));
+        }
+    }
+}
+
+} // namespace json
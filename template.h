@@ -0,0 +1,89 @@
+#pragma once
+
+#include "bind.h"
+#include "json.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a JSON skeleton with holes in it, for writing lots of responses that only
+// differ in a few values:
+//
+//   json::Template reply(R"({"status": "ok", "user": {{user}}, "n": {{n}}})");
+//   std::string text = reply.render("ann", 3);
+//   // {"status": "ok", "user": "ann", "n": 3}
+//
+// the constant parts are worked out once, rendering just copies them and
+// writes the slot values in between. slots are {{name}} where a value would
+// go (never inside a string), and take arguments in the order their names
+// first appear, so a name used twice takes one argument. arguments can be
+// anything serialiseStruct can write.
+
+namespace json
+{
+
+class Template
+{
+    // the constant parts back to back
+    std::string constants;
+    struct Segment
+    {
+        // where this constant part ends in constants
+        size_t end;
+        // which argument goes after it, npos after the last part
+        size_t slot;
+    };
+    std::vector<Segment> segments;
+    std::vector<std::string> slotNames;
+
+    Template() = default;
+    void compile(std::string_view text, bool quotedSlots);
+    // values holds the arguments, written out back to back, argument i
+    // ending at ends[i + 1]
+    void renderValues(std::string& out, std::string_view values,
+                      const size_t* ends, size_t count) const;
+
+   public:
+    // !!throws ParsingError if text isn't valid JSON (with its slots taken
+    // as values). the position is in the text with null in every slot!!
+    explicit Template(std::string_view text);
+    // a template of value, where strings that are exactly {{name}} are the
+    // slots. object keys never are, they're written out as they are.
+    static Template from(const JsonValue& value);
+
+    // slot names in argument order
+    [[nodiscard]] const std::vector<std::string>& slots() const;
+
+    // appends the template with args in its slots to out.
+    // !!throws std::invalid_argument if there isn't one arg per slot!!
+    template <typename... Args>
+    void render(std::string& out, const Args&... args) const;
+    template <typename... Args>
+    [[nodiscard]] std::string render(const Args&... args) const;
+};
+
+template <typename... Args>
+void Template::render(std::string& out, const Args&... args) const
+{
+    // the formatted arguments, kept around so rendering doesn't allocate
+    // once it's warmed up
+    thread_local std::string values;
+    values.clear();
+    std::array<size_t, sizeof...(Args) + 1> ends{};
+    size_t i = 0;
+    ((detail::write(values, args), ends[++i] = values.size()), ...);
+    renderValues(out, values, ends.data(), sizeof...(Args));
+}
+template <typename... Args>
+std::string Template::render(const Args&... args) const
+{
+    std::string result;
+    render(result, args...);
+    return result;
+}
+
+} // namespace json
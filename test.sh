@@ -0,0 +1,18 @@
+#!/bin/sh
+# builds every tests/*_test.cc against the library (with the address and
+# undefined behaviour sanitizers) and runs it
+set -e
+mkdir -p build/tests
+flags="-std=c++20 -I. -Wall -Wextra -g -fsanitize=address,undefined -pthread"
+objects=""
+for source in json.cc compact.cc bind.cc template.cc path.cc columns.cc index.cc; do
+    object="build/tests/${source%.cc}.o"
+    ${CXX:-clang++} $flags -c "$source" -o "$object"
+    objects="$objects $object"
+done
+for test in tests/*_test.cc; do
+    name=$(basename "$test" .cc)
+    ${CXX:-clang++} $flags "$test" $objects -o "build/tests/$name"
+    echo "== $name"
+    "./build/tests/$name"
+done
@@ -0,0 +1,80 @@
+#include "../bind.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+
+struct Odd
+{
+    double plain = 0;
+    std::string quoted;
+    bool control = false;
+};
+
+template <>
+struct json::Binding<Odd>
+{
+    static constexpr auto fields =
+      std::tuple{json::field("plain", &Odd::plain),
+                 json::field("say \"hi\"\\", &Odd::quoted),
+                 json::field("tab\there\x01", &Odd::control)};
+};
+
+struct Envelope
+{
+    std::string kind;
+    json::JsonValue payload;
+    int64_t after = 0;
+};
+
+template <>
+struct json::Binding<Envelope>
+{
+    static constexpr auto fields =
+      std::tuple{json::field("kind", &Envelope::kind),
+                 json::field("payload", &Envelope::payload),
+                 json::field("after", &Envelope::after)};
+};
+
+int main()
+{
+    // keys escaped while compiling come out the same as serialiseCompact
+    // escapes them at run time
+    Odd odd{.plain = 1, .quoted = "a\nb", .control = true};
+    std::string written = json::serialiseStruct(odd);
+    json::JsonValue parsed = json::parse(written);
+    std::ostringstream again;
+    json::serialiseCompact(parsed, again);
+    CHECK(written == again.str());
+    CHECK(parsed.find("say \"hi\"\\")->asString() == "a\nb");
+    CHECK(parsed.find("tab\there\x01")->asBool());
+
+    Odd back = json::parseInto<Odd>(written);
+    CHECK(back.plain == 1 && back.quoted == "a\nb" && back.control);
+
+    // unknown members skipped whole, a JsonValue member parsed where it is,
+    // and reading carries on after both
+    Envelope envelope = json::parseInto<Envelope>(
+      "\xEF\xBB\xBF"
+      R"({"skip": {"a": [1, "]", {"b": 2}]}, "kind": "k",)"
+      R"( "payload": {"x": [1, 2, {"y": null}]}, "after": 3})");
+    CHECK(envelope.kind == "k");
+    CHECK(envelope.payload.find("x")->asArray().size() == 3);
+    CHECK(envelope.after == 3);
+
+    // errors in a JsonValue member are where they are in the whole source
+    try {
+        (void)json::parseInto<Envelope>(
+          "{\"kind\": \"k\",\n\"payload\": [1,,2]}");
+        CHECK(false);
+    } catch (const json::ParsingError& e) {
+        CHECK(e.offset() == 28);
+        CHECK(e.line() == 2 && e.col() == 15);
+    }
+    CHECK_THROWS(json::parseInto<Envelope>("{\"skip\": [1, 2}"),
+                 json::ParsingError);
+    CHECK_THROWS(json::parseInto<Envelope>(R"({"skip": [1, 2}, "after": 3})"),
+                 json::ParsingError);
+
+    return check::finish();
+}
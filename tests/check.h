@@ -0,0 +1,50 @@
+#pragma once
+
+// just enough of a test framework: CHECK what should hold, and return
+// finish() from main. failures are printed and counted, and the test carries
+// on with the next check.
+
+#include <cstdio>
+
+namespace check
+{
+
+inline int failures = 0;
+
+inline void report(bool ok, const char* what, const char* file, int line)
+{
+    if (!ok) {
+        std::printf("%s:%d: CHECK(%s) failed\n", file, line, what);
+        failures++;
+    }
+}
+
+// what main returns: 0 if every check held
+inline int finish()
+{
+    if (failures != 0) {
+        std::printf("%d check(s) failed\n", failures);
+    } else {
+        std::printf("ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace check
+
+#define CHECK(condition)                                                   \
+    check::report(static_cast<bool>(condition), #condition, __FILE__,      \
+                  __LINE__)
+
+// expression has to throw an Exception (or something derived from it)
+#define CHECK_THROWS(expression, Exception)                                \
+    do {                                                                   \
+        bool thrown = false;                                               \
+        try {                                                              \
+            (void)(expression);                                            \
+        } catch (const Exception&) {                                       \
+            thrown = true;                                                 \
+        }                                                                  \
+        check::report(thrown, #expression " throws " #Exception, __FILE__, \
+                      __LINE__);                                           \
+    } while (false)
@@ -0,0 +1,86 @@
+#include "../columns.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// every cell of the columns, nulls as "-"
+std::vector<std::string> cells(const std::vector<json::Column>& columns)
+{
+    std::vector<std::string> result;
+    for (const json::Column& column : columns) {
+        for (size_t row = 0; row < column.rows; ++row) {
+            if (!column.valid(row)) {
+                result.emplace_back("-");
+                continue;
+            }
+            switch (column.type) {
+                case json::ColumnType::Number:
+                    result.push_back(std::to_string(column.numbers[row]));
+                    break;
+                case json::ColumnType::Integer:
+                    result.push_back(std::to_string(column.integers[row]));
+                    break;
+                case json::ColumnType::Bool:
+                    result.push_back(column.bools[row] != 0 ? "true"
+                                                            : "false");
+                    break;
+                case json::ColumnType::String:
+                    result.emplace_back(column.string(row));
+                    break;
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<json::ColumnSpec> schema = {
+      {"/s", json::ColumnType::String},
+      {"/n", json::ColumnType::Number},
+      {"/o/i", json::ColumnType::Integer},
+      {"/b", json::ColumnType::Bool}};
+
+    // repeated keys: the last one wins, whatever the earlier ones held,
+    // same as parsing the records and converting them
+    const char* source = R"([
+        {"s": "ab", "s": "cd", "n": 1, "n": "x", "b": true},
+        {"o": {"i": 1}, "o": {"j": 2}, "s": "eé", "s": 5},
+        {"o": {"i": 7}, "s": "", "n": 2.5, "n": 3.5, "b": false, "b": null},
+        {"s": "tail"}
+    ])";
+    auto direct = json::parseColumns(source, schema);
+    auto converted = json::toColumns(json::parse(source), schema);
+    CHECK(cells(direct) == cells(converted));
+    CHECK(direct[0].string(0) == "cd");
+    CHECK(!direct[0].valid(1));
+    CHECK(direct[0].string(3) == "tail");
+    CHECK(!direct[1].valid(0) && direct[1].numbers[2] == 3.5);
+    CHECK(!direct[2].valid(1) && direct[2].integers[2] == 7);
+
+    // pointers go into packed arrays of numbers too
+    const char* pairs = R"([{"p": [1, 2]}, {"p": [3, 4]}, {"p": [5]}])";
+    const std::vector<json::ColumnSpec> second = {
+      {"/p/1", json::ColumnType::Integer}};
+    auto parsedPairs = json::parseColumns(pairs, second);
+    CHECK(cells(json::toColumns(json::parse(pairs), second)) ==
+          cells(parsedPairs));
+    CHECK((cells(parsedPairs) == std::vector<std::string>{"2", "4", "-"}));
+
+    // a byte order mark is skipped
+    auto marked = json::parseColumns("\xEF\xBB\xBF[{\"s\": \"x\"}]", schema);
+    CHECK(marked[0].rows == 1 && marked[0].string(0) == "x");
+
+    CHECK_THROWS(json::parseColumns(R"([{"s": "a"} {"s": "b"}])", schema),
+                 json::ParsingError);
+    CHECK_THROWS(json::parseColumns(R"([{"x": [1}, "s": "a"}])", schema),
+                 json::ParsingError);
+
+    return check::finish();
+}
@@ -0,0 +1,69 @@
+#include "../compact.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+std::string compact(const json::CompactValue& value)
+{
+    std::ostringstream os;
+    os << value;
+    return os.str();
+}
+std::string compact(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    // the same output as going through JsonValue
+    const std::string source =
+      R"({"id": 7, "name": "a string longer than fourteen bytes", "s": "short",
+          "ok": true, "none": null, "list": [1, 2.5, "x", [], {}],
+          "nested": {"a": [1, 2, 3, 4, 5, 6], "b": "q\"uote\n"}})";
+    json::CompactValue value = json::parseCompact(source);
+    CHECK(compact(value) == compact(json::parse(source)));
+    CHECK(value.find("name")->asString() ==
+          "a string longer than fourteen bytes");
+    CHECK(value.find("s")->asString() == "short");
+    CHECK(value.find("nested")->find("b")->asString() == "q\"uote\n");
+    CHECK(compact(json::CompactValue::from(json::parse(source))) ==
+          compact(value));
+    CHECK(compact(value.toJsonValue()) == compact(value));
+
+    // a byte order mark is skipped, like json::parse does
+    CHECK(compact(json::parseCompact("\xEF\xBB\xBF[1, 2]")) == "[1,2]");
+    // and trailing content is an error, also like json::parse
+    CHECK_THROWS(json::parseCompact("[1] 2"), json::ParsingError);
+    CHECK_THROWS(json::parseCompact("{\"a\" 1}"), json::ParsingError);
+
+    // small containers are inline up to four elements, then spill
+    json::CompactArray array;
+    for (int i = 0; i < 10; ++i) {
+        array.push_back(i);
+        CHECK(array.size() == static_cast<size_t>(i + 1));
+    }
+    CHECK(array[3].asNumber() == 3 && array[9].asNumber() == 9);
+    json::CompactArray moved(std::move(array));
+    CHECK(moved.size() == 10 && moved[9].asNumber() == 9);
+    json::CompactArray small{1, "two", nullptr};
+    json::CompactArray copy(small);
+    copy.erase(copy.begin());
+    CHECK(copy.size() == 2 && copy[0].asString() == "two");
+    CHECK(small.size() == 3);
+
+    // empty containers are a null pointer, but still read as containers
+    json::CompactValue empty{json::CompactArray{}};
+    CHECK(empty.isArray() && empty.asArray().empty());
+    CHECK(compact(empty) == "[]");
+
+    return check::finish();
+}
@@ -0,0 +1,80 @@
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+
+std::string serialised(const json::Document& document)
+{
+    std::ostringstream os;
+    document.serialise(os);
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    // the spans live in the document, not in every value
+    static_assert(sizeof(json::JsonValue) <= 40);
+
+    const std::string source =
+      R"({"a": 1.50, "b": [1e2, "xA", {"c": 0.0}], "d": {"e": true}})";
+    json::Document document(source);
+    CHECK(serialised(document) == source);
+    const json::JsonValue& b = *std::as_const(document).find(json::Pointer("/b"));
+    CHECK(document.source(b) == R"([1e2, "xA", {"c": 0.0}])");
+    CHECK(document.source(b.asArray()[1]) == R"("xA")");
+
+    // modifying something only loses the spans on the way down to it
+    document.find(json::Pointer("/d/e"))->asBool() = false;
+    CHECK(serialised(document) ==
+          R"({"a":1.50,"b":[1e2, "xA", {"c": 0.0}],"d":{"e":false}})");
+    CHECK(document.source(document.root()).empty());
+
+    // copies aren't the document's values, and moving the document keeps
+    // its spans
+    const json::JsonValue copy = std::as_const(document).root();
+    CHECK(document.source(*copy.find("a")).empty());
+    json::Document moved = std::move(document);
+    CHECK(serialised(moved) ==
+          R"({"a":1.50,"b":[1e2, "xA", {"c": 0.0}],"d":{"e":false}})");
+
+    // adding a member can move the others, they keep their spans
+    moved.root().asObject()["f"] = 1;
+    CHECK(serialised(moved) ==
+          R"({"a":1.50,"b":[1e2, "xA", {"c": 0.0}],"d":{"e":false},"f":1})");
+    json::Document escaped(R"({"a": 1.50, "b": "\u00e9"})");
+    for (int i = 0; i < 20; ++i) {
+        escaped.root().asObject()["c" + std::to_string(i)] = i;
+    }
+    CHECK(serialised(escaped).starts_with(
+      R"({"a":1.50,"b":"\u00e9","c0":0,"c1":1,)"));
+
+    // a value takes its span along when it's moved, what's moved into its
+    // place doesn't get it
+    json::Document shifted(R"(["\u00e9", 1.50, "x"])");
+    json::JsonArray& elements = shifted.root().asArray();
+    json::JsonValue first = std::move(elements[0]);
+    elements.erase(elements.begin());
+    elements.push_back(std::move(first));
+    CHECK(serialised(shifted) == R"([1.5,"x","\u00e9"])");
+
+    // with a key twice it's the last one's values that have spans, even
+    // where the first one's memory got reused
+    json::Document twice(
+      R"({"a": [1, {"x": 2.0}], "a": [3, {"y": 4.0}], "b": [5, {"z": 6.0}]})");
+    twice.root().asObject();
+    CHECK(serialised(twice) == R"({"a":[3, {"y": 4.0}],"b":[5, {"z": 6.0}]})");
+
+    // values with comments in them are written out again
+    json::Document commented(R"({"a": [1 /* one */, 2.0], "b": 3.0})");
+    commented.root().asObject();
+    CHECK(serialised(commented) == R"({"a":[1,2],"b":3.0})");
+
+    return check::finish();
+}
@@ -0,0 +1,56 @@
+#include "../index.h"
+#include "../json.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <string>
+
+int main()
+{
+    // parsing the next document into the same tree makes the index stale
+    json::DocumentParser parser;
+    const json::JsonValue& first = parser.parse(R"([{"id": "a"}, {"id": 2}])");
+    json::Index byId(first, "/id");
+    CHECK(byId.position("a") == 0 && byId.position(2) == 1);
+    const json::JsonValue& second =
+      parser.parse(R"([{"id": "b"}, {"id": "a"}, {"id": 1.0}])");
+    CHECK(&second == &first);
+    CHECK(byId.stale());
+    CHECK_THROWS(byId.position("a"), std::logic_error);
+    byId.rebuild();
+    CHECK(!byId.stale());
+    CHECK(byId.position("b") == 0 && byId.position("a") == 1);
+    CHECK(byId.position(1) == 2 && !byId.position(2).has_value());
+    CHECK(byId.find("a")->find("id")->asString() == "a");
+
+    // so does modifying it through the accessors
+    json::JsonValue records = json::parse(R"([{"id": 1}, {"id": 2}])");
+    json::Index index(records, "/id");
+    records.asArray().push_back(json::parse(R"({"id": 3})"));
+    CHECK(index.stale());
+    index.rebuild();
+    CHECK(index.position(3) == 2 && index.size() == 3);
+
+    // through a reference taken earlier it isn't noticed, but the keys are
+    // read again rather than through pointers that went with the old
+    // elements
+    json::JsonArray& elements = records.asArray();
+    index.rebuild();
+    for (int i = 4; i < 100; ++i) {
+        elements.push_back(
+          json::parse(R"({"id": )" + std::to_string(i) + "}"));
+    }
+    CHECK(!index.stale());
+    CHECK(index.position(2) == 1);
+    elements.clear();
+    CHECK(!index.position(2).has_value());
+    CHECK(index.find(2) == nullptr);
+
+    // the index doesn't hold on to anything of the document it was built
+    // from once that's reparsed into something shorter
+    parser.parse("[]");
+    byId.rebuild();
+    CHECK(byId.size() == 0 && !byId.position("a").has_value());
+
+    return check::finish();
+}
@@ -0,0 +1,57 @@
+#include "../json.h"
+#include "check.h"
+
+#include <utility>
+
+int main()
+{
+    json::InternPool pool;
+    json::ParseOptions options{.internPool = &pool};
+
+    // equal short strings share the pool's copy, across parses too
+    json::JsonValue first = json::parse(R"(["red", "red"])", options);
+    json::JsonValue second = json::parse(R"({"colour": "red"})", options);
+    const auto& elements = std::as_const(first).asArray();
+    CHECK(&elements[0].asString() == &elements[1].asString());
+    CHECK(&elements[0].asString() ==
+          &std::as_const(second).find("colour")->asString());
+
+    // reading through a non-const value doesn't unshare it, only the
+    // non-const asString() does, since what it returns can be modified
+    json::JsonValue& colour = *second.find("colour");
+    CHECK(colour.asStringView() == "red");
+    CHECK(&std::as_const(colour).asString() == &elements[0].asString());
+    colour.asString() += "dish";
+    CHECK(colour.asStringView() == "reddish");
+    CHECK(elements[0].asStringView() == "red");
+
+    // keys go through the pool as well: these two objects have different
+    // keys, but their first one is the same pooled string
+    const char* source = R"([{"a key long enough to allocate": 1, "x": 2},
+                             {"a key long enough to allocate": 3, "y": 4}])";
+    auto firstKey = [](const json::JsonValue& array, size_t i) {
+        return &array.asArray()[i].asObject().begin()->first;
+    };
+    const json::JsonValue pooled = json::parse(source, options);
+    CHECK(firstKey(pooled, 0) == firstKey(pooled, 1));
+    CHECK(pooled.asArray()[1].find("y")->asNumber() == 4);
+    const json::JsonValue unpooled = json::parse(source);
+    CHECK(firstKey(unpooled, 0) != firstKey(unpooled, 1));
+    CHECK(*firstKey(unpooled, 1) == "a key long enough to allocate");
+
+    // escaped keys are unescaped before they're pooled or stored
+    const json::JsonValue escaped =
+      json::parse(R"([{"tab": 1}, {"tab": 2, "\n": 3}])", options);
+    CHECK(escaped.asArray()[0].find("tab") != nullptr);
+    CHECK(escaped.asArray()[1].find("\n")->asNumber() == 3);
+
+    // a pool that's full keeps handing out what it has, and nothing new
+    json::InternPool tiny(1);
+    json::ParseOptions tinyOptions{.internPool = &tiny};
+    const json::JsonValue full =
+      json::parse(R"(["one", "two", "one"])", tinyOptions);
+    CHECK(tiny.size() == 1);
+    CHECK(full.asArray()[1].asString() == "two");
+
+    return check::finish();
+}
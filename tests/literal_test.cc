@@ -0,0 +1,145 @@
+#include "../json.h"
+#include "../literal.h"
+#include "../scalars.h"
+#include "check.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace json::literals;
+
+namespace
+{
+
+// what decimalToDouble (the compile time conversion) and std::from_chars
+// (the run time one) make of text, as bits, with the error code in front
+struct Reading
+{
+    json::ErrorCode code;
+    uint64_t bits;
+
+    bool operator==(const Reading&) const = default;
+};
+Reading exact(const std::string& text)
+{
+    double value = 0;
+    auto code = json::detail::decimalToDouble(text, value);
+    return {code, code == json::ErrorCode::None ? std::bit_cast<uint64_t>(value)
+                                                : 0};
+}
+Reading fromChars(const std::string& text)
+{
+    double value = 0;
+    auto code = json::detail::fromChars(text, value);
+    return {code, code == json::ErrorCode::None ? std::bit_cast<uint64_t>(value)
+                                                : 0};
+}
+
+std::string print(const char* format, long double value)
+{
+    char buffer[1200];
+    std::snprintf(buffer, sizeof buffer, format, value);
+    return buffer;
+}
+
+constexpr double compiled(std::string_view text)
+{
+    double value = 0;
+    json::detail::parseNumber(text, value);
+    return value;
+}
+
+} // namespace
+
+int main()
+{
+    // cases that tend to come out an ulp off, and the edges of the range
+    for (const char* text :
+         {"0", "-0", "01", "-.5", "1e", "1e+", "-", "-e5", "0e99999",
+          "0.1", "0.3", "1e23", "8.98846567431158e307", "9007199254740993",
+          "9007199254740992.5", "2.2250738585072011e-308",
+          "2.2250738585072014e-308", "4.9406564584124654e-324",
+          "2.4703282292062327e-324", "2.4703282292062328e-324", "2e-324",
+          "3e-324", "1e-400", "1e400", "1.7976931348623157e308",
+          "1.7976931348623158e308", "1.7976931348623159e308",
+          "179769313486231580793728971405301e276",
+          "0.000000000000000000000000000000000000000000000000000001e-330",
+          "123456789012345678901234567890", "1.00000000000000011102230246251565"
+                                            "404236316680908203125",
+          "1.00000000000000011102230246251565404236316680908203124",
+          "1.00000000000000011102230246251565404236316680908203126",
+          "1e-99999999999999999999", "1e99999999999999999999"})
+    {
+        CHECK(exact(text) == fromChars(text));
+        if (!(exact(text) == fromChars(text))) {
+            std::printf("  for %s\n", text);
+        }
+    }
+
+    // random doubles written out in full, short and in between, and the
+    // halfway points between neighbours (exact in a long double) to a few
+    // hundred digits and cut a bit short of or past them
+    std::mt19937_64 random(41);
+    int mismatches = 0;
+    for (int i = 0; i < 2000; ++i) {
+        double value = std::bit_cast<double>(random() & ~(1ULL << 63));
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        long double half =
+          (static_cast<long double>(value) +
+           static_cast<long double>(std::nextafter(value, INFINITY))) /
+          2;
+        std::string past = print("%.800Le", half);
+        past.insert(past.find('e'), "1");
+        std::string texts[] = {
+          print("%.17Lg", value), print("%.25Lg", value),
+          print("%.6Lg", value),  print("%.800Le", half),
+          print("%.30Le", half),  past,
+        };
+        for (const std::string& text : texts) {
+            if (!(exact(text) == fromChars(text))) {
+                mismatches++;
+                std::printf("  mismatch for %s\n", text.c_str());
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // _json numbers come out the same as json::parse's
+    static constexpr auto numbers =
+      R"([0.1, 1e23, 9007199254740993, 2.2250738585072011e-308, 5e-324,
+          1.7976931348623157e308, -0.0, 2.4703282292062328e-324])"_json;
+    json::JsonValue parsed = json::parse(
+      R"([0.1, 1e23, 9007199254740993, 2.2250738585072011e-308, 5e-324,
+          1.7976931348623157e308, -0.0, 2.4703282292062328e-324])");
+    for (size_t i = 0; i < numbers.root().size(); ++i) {
+        CHECK(std::bit_cast<uint64_t>(numbers.root()[i].asNumber()) ==
+              std::bit_cast<uint64_t>(parsed.asArray()[i].asNumber()));
+    }
+    static_assert(compiled("1e23") == 1e23);
+    static_assert(compiled("9007199254740993") == 9007199254740992.0);
+    static_assert(compiled("2.4703282292062328e-324") == 5e-324);
+
+    // children straight from their index, keys included
+    static constexpr auto nested =
+      R"({"a": [1, [2, 3], {"b": 4}, 5], "c": "x", "a": [6]})"_json;
+    static_assert(nested.root().size() == 3);
+    static_assert(nested.root()[0][3].asNumber() == 5);
+    static_assert(nested.root()[0][2].keyAt(0) == "b");
+    static_assert(nested.root().keyAt(1) == "c");
+    static_assert(nested.root()[1].asString() == "x");
+    static_assert(nested.root().find("a")->operator[](0).asNumber() == 6);
+    CHECK(!nested.root().find("d").has_value());
+    CHECK_THROWS(nested.root()[3], std::out_of_range);
+    std::ostringstream copy;
+    json::serialiseCompact(nested.root().toJsonValue(), copy);
+    CHECK(copy.str() == R"({"a":[6],"c":"x"})");
+
+    return check::finish();
+}
@@ -0,0 +1,91 @@
+#include "../columns.h"
+#include "../index.h"
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::string compact(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    const json::JsonValue document =
+      json::parse(R"({"scores": [3, 1.5, -2, 1e3], "names": ["a"]})");
+    const json::JsonValue& scores = *document.find("scores");
+    CHECK(scores.isArray() && scores.isNumberArray());
+    auto numbers = scores.asNumberSpan();
+    CHECK(numbers.size() == 4 && numbers[3] == 1000);
+
+    // const readers leave the packed array as it is, so spans stay valid
+    // and several threads can read at once
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            std::ostringstream os;
+            json::serialiseParallel(document, os, 0, 2);
+            json::Index byValue(scores, "");
+            (void)byValue.position(-2);
+            (void)scores.asArray().at(3);
+            (void)json::toColumns(scores, {{"", json::ColumnType::Number}});
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(scores.isNumberArray());
+    CHECK(scores.asNumberSpan().data() == numbers.data());
+    // the const asArray() and find() read a copy made the first time, it's
+    // the same one every time after that
+    CHECK(scores.asArray().size() == 4 &&
+          scores.asArray()[3].asNumber() == 1000);
+    CHECK(&scores.asArray() == &scores.asArray());
+    CHECK(document.find(json::Pointer("/scores/1"))->asNumber() == 1.5);
+    CHECK(document.find(json::Pointer("/scores/4")) == nullptr);
+    CHECK(document.find(json::Pointer("/names/0"))->asString() == "a");
+
+    // numbers are their own keys in an index
+    json::Index byValue(scores, "");
+    CHECK(byValue.position(1.5) == 1);
+    CHECK(!byValue.position(7).has_value());
+    CHECK(byValue.find(1.5) == &scores.asArray()[1]);
+    CHECK(json::Index(scores, "/x").size() == 0);
+
+    // and the empty pointer picks them out as a column
+    auto columns = json::toColumns(scores, {{"", json::ColumnType::Integer},
+                                            {"/x", json::ColumnType::Number}});
+    CHECK(columns[0].valid(2) && columns[0].integers[2] == -2);
+    CHECK(!columns[0].valid(1));
+    CHECK(!columns[1].valid(0));
+
+    // writing through the span drops the copy, so it's made again
+    json::JsonValue copy = document;
+    json::JsonValue& rescored = copy.asObject().at("scores");
+    (void)std::as_const(rescored).asArray();
+    rescored.asNumberSpan()[0] = 5;
+    CHECK(std::as_const(rescored).asArray()[0].asNumber() == 5);
+    rescored.asNumberSpan()[0] = 3;
+
+    // the non-const accessors unpack it
+    json::JsonValue& unpacked = copy.asObject().at("scores");
+    unpacked.asArray().push_back(4);
+    CHECK(!unpacked.isNumberArray());
+    CHECK(std::as_const(unpacked).asArray().size() == 5);
+    CHECK(compact(copy) ==
+          R"({"scores":[3,1.5,-2,1000,4],"names":["a"]})");
+
+    return check::finish();
+}
@@ -0,0 +1,52 @@
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+
+std::string compact(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    json::ParseOptions precount{.precount = true};
+
+    // brackets and commas inside strings and comments don't count, and
+    // neither does a trailing comma in a comment
+    const std::string source = R"({/*c{[,*/"a\"[,": [1, 2, {"b": "],}"}],
+        "c": [], "d": {}, // x,[
+        "e": [[], [1, "x"], 3, [4, 5, 6]], "f": "[[[,,,"})";
+    const json::JsonValue counted = json::parse(source, precount);
+    CHECK(compact(counted) == compact(json::parse(source)));
+
+    // every container is allocated at exactly its final size
+    const auto& e = std::as_const(counted).find("e")->asArray();
+    CHECK(e.capacity() == e.size());
+    CHECK(e[1].asArray().capacity() == 2);
+    CHECK(std::as_const(counted).find("e")->asArray()[3].asNumberSpan().size() ==
+          3);
+
+    // raw subtrees are skipped along with their counts
+    json::ParseOptions raw{.precount = true, .rawDepth = 2};
+    const std::string nested = R"([[[1,[2]],{"k":[3]}],[4,5],[[6]]])";
+    const json::JsonValue partly = json::parse(nested, raw);
+    CHECK(compact(partly) == nested);
+    CHECK(std::as_const(partly).asArray()[0].asArray()[0].isRaw());
+    CHECK(std::as_const(partly).asArray()[2].asArray().capacity() == 1);
+
+    // invalid input still fails, the counts are only a hint
+    CHECK(!json::tryParse("[1, 2", precount));
+    CHECK(!json::tryParse("[1,, 2]", precount));
+
+    return check::finish();
+}
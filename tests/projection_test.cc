@@ -0,0 +1,71 @@
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+std::string compact(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    // * matches every member and every element, and only what had something
+    // matching in it is kept
+    const char* source = R"({
+        "users": {"ann": {"id": 1, "tags": ["a"]}, "bob": {"name": "b"},
+                  "cy": {"id": 3}},
+        "items": [{"price": 5, "sku": "x"}, {"sku": "y"}, {"price": 7}],
+        "other": [1, 2, 3]
+    })";
+    CHECK(compact(json::parse(source, {"/users/*/id", "/items/*/price"})) ==
+          R"({"users":{"ann":{"id":1},"cy":{"id":3}},)"
+          R"("items":[{"price":5},{"price":7}]})");
+    CHECK(compact(json::parse(source, {"/other/1"})) == R"({"other":[2]})");
+    CHECK(compact(json::parse(source, {"/users/ann"})) ==
+          R"({"users":{"ann":{"id":1,"tags":["a"]}}})");
+    CHECK(json::parse(source, {"/missing"}).isNull());
+
+    // keys are compared unescaped, and escaped keys that get skipped aren't
+    // unescaped at all (but still have to be valid strings)
+    const char* escaped = R"({"a": 1, "b\"c": {"\n": [2]}, "d": 3})";
+    CHECK(compact(json::parse(escaped, {"/a"})) == R"({"a":1})");
+    CHECK(compact(json::parse(escaped, {"/d"})) == R"({"d":3})");
+    CHECK(compact(json::parse(escaped, {"/b\"c"})) == R"({"b\"c":{"\n":[2]}})");
+
+    // skipped arrays and objects are checked for brackets that close what
+    // they opened, and for closed strings and comments
+    for (const char* bad :
+         {R"({"a": [1, 2}, "b": 3})", R"({"a": {"k": 1], "b": 3})",
+          R"({"a": [{"k": [1]]}, "b": 3})", R"({"a": ["x}, "b": 3})",
+          R"({"a": [1 /* two, "b": 3})", R"({"a": [[1], "b": 3})"})
+    {
+        CHECK(!json::tryParse(bad));
+        CHECK(!json::tryParse(bad, json::Projection{"/b"}));
+    }
+    CHECK_THROWS(json::parse(R"({"a": [1, 2}, "b": 3})", {"/b"}),
+                 json::ParsingError);
+
+    // but what's in them isn't looked at any closer than that
+    CHECK(compact(json::parse(R"({"a": [1,, tru], "b": 3})", {"/b"})) ==
+          R"({"b":3})");
+
+    // deep nesting is checked all the way down
+    std::string deep(100, '[');
+    deep += std::string(50, ']') + '}' + std::string(49, ']');
+    CHECK(!json::tryParse(R"({"a": )" + deep + R"(, "b": 1})",
+                          json::Projection{"/b"}));
+    deep = std::string(100, '[') + std::string(100, ']');
+    CHECK(compact(json::parse(R"({"a": )" + deep + R"(, "b": 1})", {"/b"})) ==
+          R"({"b":1})");
+
+    return check::finish();
+}
@@ -0,0 +1,88 @@
+#include "../json.h"
+#include "../path.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// the selection as compact JSON, one value after another
+std::string compact(const json::Selection& selection)
+{
+    std::ostringstream os;
+    for (const json::JsonValue* value : selection) {
+        json::serialiseCompact(*value, os);
+        os << ' ';
+    }
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    const json::JsonValue root = json::parse(
+      R"({"readings": [4, 120.5, -1, 300], "pairs": [[1, 2], [3, 4]],
+          "items": [{"price": 150, "sizes": [38, 42]}, {"price": 20}]})");
+    const json::JsonValue& readings = *root.find("readings");
+    const auto numbers = readings.asNumberSpan();
+
+    // packed arrays are read where they are, elements come out as copies
+    CHECK(compact(json::Query("$.readings[*]").run(root)) == "4 120.5 -1 300 ");
+    CHECK(compact(json::Query("$.readings[-1]").run(root)) == "300 ");
+    CHECK(compact(json::Query("$.readings[?(@ > 100)]").run(root)) ==
+          "120.5 300 ");
+    CHECK(compact(json::Query("$.pairs[?(@[1] == 4)]").run(root)) == "[3,4] ");
+    CHECK(compact(json::Query("$.items[?(@.sizes[1] >= 42)].price").run(
+            root)) == "150 ");
+    CHECK(compact(json::Query("$..sizes[0]").run(root)) == "38 ");
+    CHECK(json::Query("$..*").run(root).size() == 20);
+    CHECK(readings.isNumberArray() && readings.asNumberSpan().data() ==
+                                        numbers.data());
+
+    // moving a selection keeps its copies where they are
+    json::Selection selection = json::Query("$.readings[0]").run(root);
+    const json::JsonValue* first = selection[0];
+    json::Selection moved = std::move(selection);
+    CHECK(moved[0] == first && first->asNumber() == 4);
+
+    // nothing is modified, so several threads can query at once
+    std::vector<std::thread> threads;
+    std::vector<size_t> counts(4);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            counts[i] = json::Query("$..[?(@ > 2)]").run(root).size();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t count : counts) {
+        CHECK(count == 9);
+    }
+    CHECK(readings.isNumberArray());
+
+    // streamQuery's filters see into packed arrays too
+    std::istringstream input(R"({"pairs": [[1, 2], [3, 4]]})");
+    std::vector<std::string> matches;
+    json::streamQuery(input, json::Path("$.pairs[?(@[0] == 3)][1]"),
+                      [&](const json::JsonValue& match) {
+                          std::ostringstream os;
+                          json::serialiseCompact(match, os);
+                          matches.push_back(os.str());
+                      });
+    CHECK(matches == std::vector<std::string>{"4"});
+
+    // and what they skip has to close the brackets it opens
+    std::istringstream mismatched(R"({"a": [1, 2}, "b": 3})");
+    CHECK_THROWS(json::streamQuery(mismatched, json::Path("$.b"),
+                                   [](const json::JsonValue&) {}),
+                 json::ParsingError);
+
+    return check::finish();
+}
@@ -0,0 +1,97 @@
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+json::ParseOptions rawBelow(size_t depth)
+{
+    json::ParseOptions options;
+    options.rawDepth = depth;
+    return options;
+}
+
+std::string pretty(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    os << value;
+    return os.str();
+}
+
+} // namespace
+
+int main()
+{
+    // raw containers are checked as they're skipped, and fail the same way
+    // (and at the same place in the source) as parsing them would
+    for (const char* bad :
+         {R"({"a": [1,,tru}, "b": 2})", R"({"a": {"k" 1}})", R"([[1, 2,]])",
+          R"({"a": [01e]})", R"({"a": {"k": 1,}})", R"({"a": [1 2]})",
+          "{\"a\": [\"\\q\"]}", R"({"a": {1: 2}})", R"({"a": [}})",
+          "{\"a\":\n  [1,\n   -]}", R"({"a": [1e999]})", R"({"a": [1)"})
+    {
+        auto raw = json::tryParse(bad, rawBelow(1));
+        auto full = json::tryParse(bad);
+        CHECK(!raw && !full);
+        if (!raw && !full) {
+            CHECK(raw.error().code == full.error().code);
+            CHECK(raw.error().offset == full.error().offset);
+            CHECK(raw.error().line == full.error().line);
+            CHECK(raw.error().col == full.error().col);
+        }
+    }
+
+    // and valid ones read back the same, pretty printing included
+    const char* good = R"({"a": [1, {"b": [true, null, "x\n"]}, []],
+                           "c": {}, "d": [[-0.5e3], {"e": {"f": "g"}}]})";
+    for (size_t depth : {1, 2, 3}) {
+        json::JsonValue raw = json::parse(good, rawBelow(depth));
+        CHECK(pretty(raw) == pretty(json::parse(good)));
+    }
+
+    // looking inside from const references leaves the value raw, parses
+    // once (copies sharing it), and is fine from several threads
+    const json::JsonValue message = json::parse(good, rawBelow(1));
+    const json::JsonValue& body = *message.find("d");
+    const json::JsonValue copy = body;
+    std::vector<const json::JsonValue*> found(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < found.size(); ++i) {
+        threads.emplace_back([&, i] {
+            found[i] = (i % 2 == 0 ? body : copy)
+                         .find(json::Pointer("/1/e/f"));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(body.isRaw() && copy.isRaw());
+    for (const json::JsonValue* value : found) {
+        CHECK(value == found[0]);
+    }
+    CHECK(found[0]->asStringView() == "g");
+    CHECK(&body.materialize() == &copy.materialize());
+
+    // the non-const accessors parse in place
+    json::JsonValue owned = body;
+    CHECK(owned.asArray().size() == 2 && !owned.isRaw());
+    CHECK(body.isRaw());
+
+    // text handed to RawJson isn't checked until something looks inside,
+    // and then the positions are within that text
+    const json::JsonValue handMade(json::RawJson("[1,\n2,,]"));
+    CHECK(handMade.isArray());
+    try {
+        (void)handMade.asArray();
+        CHECK(false);
+    } catch (const json::ParsingError& e) {
+        CHECK(e.line() == 2 && e.offset() == 6);
+    }
+
+    return check::finish();
+}
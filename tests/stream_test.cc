@@ -0,0 +1,78 @@
+#include "../json.h"
+#include "check.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::string compact(const json::JsonValue& value)
+{
+    std::ostringstream os;
+    json::serialiseCompact(value, os);
+    return os.str();
+}
+
+// every value in source, compactly
+std::vector<std::string> values(std::string_view source)
+{
+    std::vector<std::string> result;
+    for (json::JsonValue& value : json::DocumentStream(source)) {
+        result.push_back(compact(value));
+    }
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    // parsePrefix stops right after the value, whatever comes next
+    auto prefix = json::parsePrefix(R"({"a": [1, 2]} trailing {)");
+    CHECK(compact(prefix.value) == R"({"a":[1,2]})");
+    CHECK(prefix.consumed == 13);
+    CHECK(json::parsePrefix("  42,43").consumed == 4);
+    CHECK(json::parsePrefix("\"x\"\"y\"").consumed == 3);
+    CHECK(!json::tryParsePrefix("  ,42"));
+    CHECK(!json::tryParsePrefix(R"({"a": 1)"));
+
+    // values back to back, with whitespace and comments between them
+    CHECK((values("{\"a\": 1}\n[2]\n\n\"three\"  4 /* five */ null // six\n") ==
+           std::vector<std::string>{R"({"a":1})", "[2]", R"("three")", "4",
+                                    "null"}));
+    CHECK((values("1 2") == std::vector<std::string>{"1", "2"}));
+    CHECK(values("  \n").empty());
+
+    // RFC 7464 text sequences: a record separator before each value
+    CHECK((values("\x1E{\"a\": 1}\n\x1E[2]\n") ==
+           std::vector<std::string>{R"({"a":1})", "[2]"}));
+
+    // consumed() counts to the end of the last value
+    json::DocumentStream stream(R"({"a": 1}  [2, 3] )");
+    CHECK(stream.next() != nullptr && stream.consumed() == 8);
+    json::JsonValue* second = stream.next();
+    CHECK(second != nullptr && compact(*second) == "[2,3]");
+    CHECK(stream.consumed() == 16);
+    CHECK(stream.next() == nullptr);
+
+    // an error in a later value is where it is in the whole buffer
+    json::DocumentStream broken("{\"a\": 1}\n{\"b\": [1,,2]}\n");
+    CHECK(broken.next() != nullptr);
+    auto failed = broken.tryNext();
+    CHECK(!failed);
+    CHECK(failed.error().offset == 18);
+    CHECK(failed.error().line == 2 && failed.error().col == 10);
+    json::DocumentStream thrown("1\n[1,,2]");
+    (void)thrown.next();
+    try {
+        (void)thrown.next();
+        CHECK(false);
+    } catch (const json::ParsingError& e) {
+        CHECK(e.offset() == 5);
+        CHECK(e.line() == 2 && e.col() == 4);
+    }
+
+    return check::finish();
+}
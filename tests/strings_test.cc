@@ -0,0 +1,53 @@
+#include "../json.h"
+#include "check.h"
+
+#include <string>
+#include <utility>
+
+namespace
+{
+
+// the string value of "text" (text already escaped), parsed from a plain
+// and from a padded source
+std::pair<std::string, std::string> parseBoth(const std::string& text)
+{
+    const std::string source = "\"" + text + "\"";
+    json::PaddedString padded(source);
+    return {json::parse(source).asString(), json::parse(padded).asString()};
+}
+
+} // namespace
+
+int main()
+{
+    // a special byte at every offset of the eight byte words the lexer
+    // skips, in strings of every length around a word or two
+    for (size_t length = 0; length < 20; ++length) {
+        for (size_t at = 0; at < length; ++at) {
+            for (const char* special : {"\\\"", "\\\\", "\\n", "\xC3\xA9"}) {
+                std::string text(length, 'a');
+                text.replace(at, 1, special);
+                std::string expected(length, 'a');
+                expected.replace(at, 1,
+                                 special[0] == '\\'
+                                   ? std::string(1, special[1] == 'n'
+                                                      ? '\n'
+                                                      : special[1])
+                                   : std::string(special));
+                auto [plain, padded] = parseBoth(text);
+                CHECK(plain == expected);
+                CHECK(padded == expected);
+            }
+        }
+    }
+
+    // what ends or breaks a string is found wherever it is
+    CHECK(!json::tryParse("\"abcdefghij"));
+    CHECK(json::parse("\"abcdefgh\nij\"").asString() == "abcdefgh\nij");
+    CHECK(!json::tryParse("\"abcdefghij\xFF\""));
+    CHECK(!json::tryParse("\"abcdefghij\\x\""));
+    CHECK(json::parse(R"("\ud83d\ude00 and \u00e9")").asString() ==
+          "\xF0\x9F\x98\x80 and \xC3\xA9");
+
+    return check::finish();
+}
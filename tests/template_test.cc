@@ -0,0 +1,44 @@
+#include "../json.h"
+#include "../template.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main()
+{
+    // a name used twice takes one argument, in the order names first appear
+    json::Template pair(R"({"a": {{x}}, "b": {{ y }}, "c": [{{x}}]})");
+    CHECK((pair.slots() == std::vector<std::string>{"x", "y"}));
+    CHECK(pair.render(1, "two") == R"({"a": 1, "b": "two", "c": [1]})");
+
+    // {{ inside a string is just text
+    json::Template quoted(R"({"say": "{{not a slot}}", "n": {{n}}})");
+    CHECK(quoted.slots().size() == 1);
+    CHECK(quoted.render(3.5) == R"({"say": "{{not a slot}}", "n": 3.5})");
+
+    // there has to be one argument per slot
+    CHECK_THROWS(pair.render(1), std::invalid_argument);
+    CHECK_THROWS(pair.render(1, 2, 3), std::invalid_argument);
+    CHECK_THROWS(quoted.render(), std::invalid_argument);
+
+    // with slots as null it has to be valid JSON
+    CHECK_THROWS(json::Template(R"({"a": {{x}})"), json::ParsingError);
+    CHECK_THROWS(json::Template(R"({"a": {{x})"), json::ParsingError);
+
+    // from() a value takes strings that are exactly {{name}} as slots, the
+    // value's written out compactly around them, and keys stay keys
+    json::Template built = json::Template::from(json::parse(
+      R"({"{{key}}": "{{v}}", "list": ["{{v}}", " {{v}}", "{{w}}"]})"));
+    CHECK((built.slots() == std::vector<std::string>{"v", "w"}));
+    CHECK(built.render(true, nullptr) ==
+          R"({"{{key}}":true,"list":[true," {{v}}",null]})");
+
+    // the same template written out by hand renders the same
+    json::Template text(
+      R"({"{{key}}":{{v}},"list":[{{v}}," {{v}}",{{w}}]})");
+    CHECK(text.render(true, nullptr) == built.render(true, nullptr));
+
+    return check::finish();
+}